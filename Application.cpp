@@ -1,6 +1,13 @@
 #include "Application.h"
 #include "classes/Chess.h"
+#include "classes/EvalTrace.h"
+#include "classes/OpeningBook.h"
+#include "classes/Search.h"
+#include "classes/Tablebase.h"
 #include "imgui/imgui.h"
+#include <algorithm>
+#include <iostream>
+#include <thread>
 
 namespace ClassGame {
 //
@@ -37,6 +44,75 @@ void RenderGame() {
   ImGui::Text("Current Move List: \n%s",
               movesToString(game->getCurrentMoves()).c_str());
 
+  int searchThreads = getSearchThreads();
+  int maxThreads = std::max(1, (int)std::thread::hardware_concurrency());
+  if (ImGui::SliderInt("Search Threads", &searchThreads, 1, maxThreads))
+    setSearchThreads(searchThreads);
+
+  bool deterministic = getDeterministicSearch();
+  if (ImGui::Checkbox("Deterministic Search", &deterministic))
+    setDeterministicSearch(deterministic);
+
+  bool cooperative = game->getCooperativeSearch();
+  if (ImGui::Checkbox("Cooperative Search (no thread)", &cooperative))
+    game->setCooperativeSearch(cooperative);
+
+  bool pondering = game->getPondering();
+  if (ImGui::Checkbox("Ponder", &pondering))
+    game->setPondering(pondering);
+
+  static char networkPath[256] = "nn.cnnue";
+  ImGui::InputText("Network File", networkPath, sizeof(networkPath));
+  if (ImGui::Button("Load Network") && !loadNetwork(networkPath))
+    std::cout << "couldn't load network " << networkPath << std::endl;
+  if (networkLoaded()) {
+    bool useNetwork = getUseNetwork();
+    if (ImGui::Checkbox("NNUE Evaluation", &useNetwork))
+      setUseNetwork(useNetwork);
+  }
+
+  static char bookPath[256] = "book.bin";
+  ImGui::InputText("Book File", bookPath, sizeof(bookPath));
+  if (ImGui::Button("Load Book") && !loadBook(bookPath))
+    std::cout << "couldn't load book " << bookPath << std::endl;
+  if (bookLoaded()) {
+    bool useBook = getUseBook();
+    if (ImGui::Checkbox("Opening Book", &useBook))
+      setUseBook(useBook);
+  }
+
+  static char syzygyPath[256] = "syzygy";
+  ImGui::InputText("Syzygy Directory", syzygyPath, sizeof(syzygyPath));
+  if (ImGui::Button("Load Syzygy") && !loadSyzygy(syzygyPath))
+    std::cout << "no syzygy tables in " << syzygyPath << std::endl;
+  if (std::shared_ptr<const SyzygyTables> syzygy = activeSyzygy())
+    ImGui::Text("Syzygy: %d tables, up to %d pieces", syzygy->tableCount(),
+                syzygy->maxPieces());
+
+  if (ImGui::Button("Trace Evaluation"))
+    std::cout << traceEvaluation(game->getBoard()) << std::endl;
+
+  if (ImGui::CollapsingHeader("Search Stats")) {
+    SearchStats stats = getSearchStats();
+    ImGui::Text("Nodes: %llu (leaf %llu)", (unsigned long long)stats.nodes,
+                (unsigned long long)stats.leafNodes);
+    ImGui::Text("NPS: %.0f", stats.nps());
+    ImGui::Text("Depth: %d  Seldepth: %d", stats.depth, stats.selDepth);
+    ImGui::Text("TT Hit Rate: %.1f%%", stats.ttHitRate() * 100);
+    ImGui::Text("Eval Cache Hit Rate: %.1f%%",
+                stats.evalCacheHitRate() * 100);
+    ImGui::Text("Lazy Evals: %.1f%%", stats.lazyEvalRate() * 100);
+    ImGui::Text("Tablebase Hits: %llu (%d tables ready)",
+                (unsigned long long)stats.tbHits, tablebasesReady());
+    ImGui::Text("First Move Cutoffs: %.1f%%",
+                stats.firstMoveCutoffRate() * 100);
+    ImGui::Text("Branching Factor: %.2f", stats.branchingFactor());
+    for (size_t i = 0; i < stats.iterationMs.size(); i++)
+      ImGui::Text("  depth %zu: %.1f ms, %llu nodes", i + 1,
+                  stats.iterationMs[i],
+                  (unsigned long long)stats.iterationNodes[i]);
+  }
+
   if (gameOver) {
     ImGui::Text("Game Over!");
     ImGui::Text("Winner: %d", gameWinner);
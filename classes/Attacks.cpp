@@ -0,0 +1,239 @@
+#include "Attacks.h"
+#include "PieceSquareTables.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+
+const uint64_t FILE_A = 0x0101010101010101ULL;
+const uint64_t FILE_H = FILE_A << 7;
+
+// mobility is scored per square above or below what the piece usually has, so
+// a knight with 4 safe squares scores nothing
+const int MOBILITY_BASE[7] = {0, 0, 4, 6, 7, 13, 0};
+
+// how much each piece type attacking the king zone counts for
+const int KING_ATTACK_WEIGHT[7] = {0, 0, 2, 2, 3, 5, 0};
+const int MAX_ATTACK_UNITS = 100;
+
+// the values live in EvalParameters.h, packed here
+const int PAWN_THREAT = makeScore(MG_PAWN_THREAT, EG_PAWN_THREAT);
+const int HANGING_PIECE = makeScore(MG_HANGING_PIECE, EG_HANGING_PIECE);
+const int SPACE_BONUS = makeScore(MG_SPACE, EG_SPACE);
+
+// the more attackers the worse it gets, faster than linear, so one piece
+// near the king is nothing but a few coordinated ones are a real danger
+constexpr std::array<int, MAX_ATTACK_UNITS> generateSafetyTable() {
+  std::array<int, MAX_ATTACK_UNITS> table{};
+  for (int units = 0; units < MAX_ATTACK_UNITS; units++)
+    table[units] = std::min(500, units * units / 4 + units);
+  return table;
+}
+
+constexpr auto SAFETY_TABLE = generateSafetyTable();
+
+static constexpr uint64_t stepAttacks(int square, const int (*steps)[2],
+                                      int count) {
+  uint64_t attacks = 0;
+  int rank = square / 8;
+  int file = square % 8;
+  for (int i = 0; i < count; i++) {
+    int r = rank + steps[i][0];
+    int f = file + steps[i][1];
+    if (r >= 0 && r < 8 && f >= 0 && f < 8)
+      attacks |= 1ULL << (r * 8 + f);
+  }
+  return attacks;
+}
+
+constexpr int KNIGHT_STEPS[8][2] = {{1, 2},  {2, 1},  {2, -1}, {1, -2},
+                                    {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+constexpr int KING_STEPS[8][2] = {{1, 0},  {1, 1},   {0, 1},  {-1, 1},
+                                  {-1, 0}, {-1, -1}, {0, -1}, {1, -1}};
+constexpr int ROOK_DIRECTIONS[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+constexpr int BISHOP_DIRECTIONS[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+constexpr auto generateStepTable(const int (*steps)[2]) {
+  std::array<uint64_t, 64> table{};
+  for (int square = 0; square < 64; square++)
+    table[square] = stepAttacks(square, steps, 8);
+  return table;
+}
+
+constexpr auto KNIGHT_ATTACKS = generateStepTable(KNIGHT_STEPS);
+constexpr auto KING_ATTACKS = generateStepTable(KING_STEPS);
+
+static uint64_t slidingAttacks(int square, uint64_t occupied,
+                               const int (*directions)[2]) {
+  uint64_t attacks = 0;
+  for (int i = 0; i < 4; i++) {
+    int rank = square / 8 + directions[i][0];
+    int file = square % 8 + directions[i][1];
+    while (rank >= 0 && rank < 8 && file >= 0 && file < 8) {
+      int target = rank * 8 + file;
+      attacks |= 1ULL << target;
+      if ((occupied >> target) & 1)
+        break;
+      rank += directions[i][0];
+      file += directions[i][1];
+    }
+  }
+  return attacks;
+}
+
+uint64_t pieceAttacks(ChessPiece piece, int square, uint64_t occupied) {
+  switch (piece) {
+  case Knight:
+    return KNIGHT_ATTACKS[square];
+  case Bishop:
+    return slidingAttacks(square, occupied, BISHOP_DIRECTIONS);
+  case Rook:
+    return slidingAttacks(square, occupied, ROOK_DIRECTIONS);
+  case Queen:
+    return slidingAttacks(square, occupied, BISHOP_DIRECTIONS) |
+           slidingAttacks(square, occupied, ROOK_DIRECTIONS);
+  case King:
+    return KING_ATTACKS[square];
+  default:
+    return 0;
+  }
+}
+
+uint64_t pawnAttacks(int side, uint64_t pawns) {
+  uint64_t notA = pawns & ~FILE_A;
+  uint64_t notH = pawns & ~FILE_H;
+  if (side == 0)
+    return (notA << 7) | (notH << 9);
+  return (notA >> 9) | (notH >> 7);
+}
+
+static void addAttacks(AttackInfo &info, int side, ChessPiece piece,
+                       uint64_t attacks) {
+  info.attackedTwice[side] |= info.attacks[side][0] & attacks;
+  info.attacks[side][piece] |= attacks;
+  info.attacks[side][0] |= attacks;
+}
+
+static void computeAttacks(const Board &board, AttackInfo &info) {
+  for (int square = 0; square < 64; square++) {
+    char piece = board.state[square];
+    if (piece == '0')
+      continue;
+    int side = isWhite(piece) ? 0 : 1;
+    info.pieces[side][charToPiece(piece)] |= 1ULL << square;
+    info.pieces[side][0] |= 1ULL << square;
+  }
+
+  uint64_t occupied = info.pieces[0][0] | info.pieces[1][0];
+  uint64_t kingZone[2];
+  for (int side = 0; side < 2; side++) {
+    addAttacks(info, side, Pawn, pawnAttacks(side, info.pieces[side][Pawn]));
+    int king = board.kingSquare[side];
+    kingZone[side] = king < 0 ? 0 : KING_ATTACKS[king] | 1ULL << king;
+  }
+
+  for (int side = 0; side < 2; side++) {
+    int enemy = 1 - side;
+    // squares a piece could actually go to without being taken by a pawn
+    uint64_t mobilityArea = ~info.pieces[side][0] & ~info.attacks[enemy][Pawn];
+
+    for (int type = Knight; type <= King; type++) {
+      ChessPiece piece = (ChessPiece)type;
+      for (uint64_t left = info.pieces[side][type]; left != 0;
+           left &= left - 1) {
+        int square = std::countr_zero(left);
+        uint64_t attacks = pieceAttacks(piece, square, occupied);
+        addAttacks(info, side, piece, attacks);
+
+        if (piece == King)
+          continue;
+
+        int safeSquares = std::popcount(attacks & mobilityArea);
+        info.mobility[side] += (safeSquares - MOBILITY_BASE[type]) *
+                               makeScore(MG_MOBILITY[type], EG_MOBILITY[type]);
+        info.mobilityCount[side][type] += safeSquares - MOBILITY_BASE[type];
+
+        uint64_t zoneAttacks = attacks & kingZone[enemy];
+        if (zoneAttacks != 0) {
+          info.kingAttackers[enemy]++;
+          info.kingAttackUnits[enemy] +=
+              KING_ATTACK_WEIGHT[type] * std::popcount(zoneAttacks);
+        }
+      }
+    }
+  }
+}
+
+const AttackInfo &attacksFor(const Board &board) {
+  static thread_local std::unique_ptr<AttackInfo[]> cache =
+      std::make_unique<AttackInfo[]>(256);
+
+  AttackInfo &info = cache[board.hash & 255];
+  if (info.key == board.hash && info.key != 0)
+    return info;
+
+  info = AttackInfo();
+  info.key = board.hash;
+  computeAttacks(board, info);
+  return info;
+}
+
+template <bool Trace>
+int evaluateAttacks(const Board &board, const AttackInfo &info,
+                    EvalTrace *trace) {
+  int score = 0;
+
+  for (int side = 0; side < 2; side++) {
+    int enemy = 1 - side;
+    int sign = side == 0 ? 1 : -1;
+    int sideScore = info.mobility[side];
+    traceTerm<Trace>(trace, TermMobility, side, info.mobility[side]);
+    for (int type = Knight; type <= Queen; type++)
+      traceCount<Trace>(trace, ParamMobility + type, side,
+                        info.mobilityCount[side][type]);
+
+    // a single attacker can't do much on its own
+    if (info.kingAttackers[side] >= 2) {
+      int units = std::min(info.kingAttackUnits[side], MAX_ATTACK_UNITS - 1);
+      sideScore -= makeScore(SAFETY_TABLE[units], 0);
+      traceTerm<Trace>(trace, TermKingSafety, side,
+                       -makeScore(SAFETY_TABLE[units], 0));
+    }
+
+    // their pieces (not pawns or the king) hit by our pawns, and anything of
+    // theirs we attack that nothing defends
+    uint64_t enemyPieces = info.pieces[enemy][0] & ~info.pieces[enemy][Pawn] &
+                           ~info.pieces[enemy][King];
+    int threatCount = std::popcount(enemyPieces & info.attacks[side][Pawn]);
+    int threats = PAWN_THREAT * threatCount;
+    uint64_t hanging = (info.pieces[enemy][0] & ~info.pieces[enemy][King]) &
+                       info.attacks[side][0] & ~info.attacks[enemy][0];
+    int hangingScore = HANGING_PIECE * std::popcount(hanging);
+    sideScore += threats + hangingScore;
+    traceTerm<Trace>(trace, TermPawnThreats, side, threats);
+    traceTerm<Trace>(trace, TermHangingPieces, side, hangingScore);
+    traceCount<Trace>(trace, ParamPawnThreat, side, threatCount);
+    traceCount<Trace>(trace, ParamHangingPiece, side,
+                      std::popcount(hanging));
+
+    // room to move behind our pawns in the centre
+    uint64_t centerFiles = (FILE_A << 2) | (FILE_A << 3) | (FILE_A << 4) |
+                           (FILE_A << 5);
+    uint64_t ownHalf =
+        side == 0 ? 0x00000000FFFFFF00ULL : 0x00FFFFFF00000000ULL;
+    uint64_t space = centerFiles & ownHalf & ~info.pieces[side][Pawn] &
+                     ~info.attacks[enemy][Pawn];
+    sideScore += SPACE_BONUS * std::popcount(space);
+    traceTerm<Trace>(trace, TermSpace, side,
+                     SPACE_BONUS * std::popcount(space));
+    traceCount<Trace>(trace, ParamSpace, side, std::popcount(space));
+
+    score += sign * sideScore;
+  }
+
+  return score;
+}
+
+template int evaluateAttacks<false>(const Board &board, const AttackInfo &info,
+                                    EvalTrace *trace);
+template int evaluateAttacks<true>(const Board &board, const AttackInfo &info,
+                                   EvalTrace *trace);
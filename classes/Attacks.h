@@ -0,0 +1,44 @@
+#pragma once
+#include "Board.h"
+#include "EvalTrace.h"
+#include <cstdint>
+#include <memory>
+
+// bitboards use the same square numbering as Board::state, bit 0 is a1
+
+// which squares every piece type of each side attacks, plus the things the
+// evaluation collects while walking the pieces anyway. built once per position
+// and shared by the evaluation, the move picker and check detection
+struct AttackInfo {
+  uint64_t key = 0;
+  // [side][ChessPiece], index 0 is every piece of that side
+  uint64_t pieces[2][7] = {};
+  uint64_t attacks[2][7] = {};
+  // squares attacked by at least two pieces of a side
+  uint64_t attackedTwice[2] = {};
+  // packed mg/eg, each side's own
+  int mobility[2] = {};
+  // the safe squares above or below the usual number that went into it, by
+  // piece type
+  int mobilityCount[2][7] = {};
+  // pieces attacking the squares around each side's king, and how hard
+  int kingAttackers[2] = {};
+  int kingAttackUnits[2] = {};
+
+  bool isAttacked(int square, int bySide) const {
+    return (attacks[bySide][0] >> square) & 1;
+  }
+};
+
+uint64_t pawnAttacks(int side, uint64_t pawns);
+// squares a knight, bishop, rook, queen or king on square attacks
+uint64_t pieceAttacks(ChessPiece piece, int square, uint64_t occupied);
+
+// attack info for the board, from a small per-thread cache keyed by the
+// board's hash so the same position is only walked once
+const AttackInfo &attacksFor(const Board &board);
+
+// mobility, king safety, threats and space, packed mg/eg from white's side
+template <bool Trace = false>
+int evaluateAttacks(const Board &board, const AttackInfo &info,
+                    EvalTrace *trace = nullptr);
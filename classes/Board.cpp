@@ -1,4 +1,10 @@
 #include "Board.h"
+#include "PieceSquareTables.h"
+#include "Zobrist.h"
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <sstream>
 
 bool isWhite(char piece) {
   const char *wpieces = "?PNBRQK";
@@ -77,7 +83,7 @@ void Board::handleEnpas(int endSquare, bool isWhiteTurn) {
   offset = isWhiteTurn ? -8 : 8;
   captureIndex = endSquare + offset;
 
-  state[captureIndex] = '0';
+  setSquare(captureIndex, '0');
 }
 
 void Board::handleCastling(int startSquare, int endSquare, bool isWhiteTurn) {
@@ -99,8 +105,8 @@ void Board::handleCastling(int startSquare, int endSquare, bool isWhiteTurn) {
   int row = isWhiteTurn ? 0 : 7;
   rookChar = isWhiteTurn ? 'R' : 'r';
 
-  state[rookIndex] = rookChar;
-  state[8 * row + rookStartColumn] = '0';
+  setSquare(rookIndex, rookChar);
+  setSquare(8 * row + rookStartColumn, '0');
 }
 
 void Board::handlePromotion(int startSquare, int endSquare, bool isWhiteTurn) {
@@ -112,7 +118,7 @@ void Board::handlePromotion(int startSquare, int endSquare, bool isWhiteTurn) {
 
   char queenChar = isWhiteTurn ? 'Q' : 'q';
 
-  state[startSquare] = queenChar;
+  setSquare(startSquare, queenChar);
 }
 
 // this is where we handle castling and en passant
@@ -158,12 +164,191 @@ void Board::updateExtrinsicState(Move move) {
   }
 }
 
+// every write to state goes through here so the hash and the running scores
+// stay in sync
+void Board::setSquare(int index, char piece) {
+  hash ^= zobristPieceKey(state[index], index) ^ zobristPieceKey(piece, index);
+
+  // the material key has one key per piece type and count, so it only
+  // depends on how many of each piece there are
+  int removed = zobristPieceIndex(state[index]);
+  if (removed >= 0) {
+    psqtScore -= pieceSquareScores.scores[removed][index];
+    materialHash ^= zobrist.pieces[removed][--pieceCounts[removed]];
+  }
+  int added = zobristPieceIndex(piece);
+  if (added >= 0) {
+    psqtScore += pieceSquareScores.scores[added][index];
+    materialHash ^= zobrist.pieces[added][pieceCounts[added]++];
+  }
+
+  if (state[index] != '0' && dirtyCount < MAX_DIRTY_PIECES)
+    dirty[dirtyCount++] = DirtyPiece{state[index], (int8_t)index, false};
+  if (piece != '0' && dirtyCount < MAX_DIRTY_PIECES)
+    dirty[dirtyCount++] = DirtyPiece{piece, (int8_t)index, true};
+
+  if (state[index] == 'P' || state[index] == 'p')
+    pawnHash ^= zobristPieceKey(state[index], index);
+  if (piece == 'P' || piece == 'p')
+    pawnHash ^= zobristPieceKey(piece, index);
+  // the king is always moved by writing its new square after clearing the old
+  // one, so this is all it takes
+  if (piece == 'K' || piece == 'k')
+    kingSquare[piece == 'K' ? 0 : 1] = index;
+
+  state[index] = piece;
+}
+
 void Board::makeMove(Move move) {
+  hash ^= zobrist.castling[castleStatus] ^ zobristEnPassantKey(enPassantIndex);
+  dirtyCount = 0;
+
+  bool irreversible = charToPiece(state[move.StartSquare]) == Pawn ||
+                      state[move.EndSquare] != '0';
+  halfmoveClock = irreversible ? 0 : halfmoveClock + 1;
+
+  // only valid for the move right after a double pawn push
+  enPassantIndex = 64;
   updateExtrinsicState(move);
 
   char piece = state[move.StartSquare];
-  state[move.StartSquare] = '0';
-  state[move.EndSquare] = piece;
+  setSquare(move.StartSquare, '0');
+  setSquare(move.EndSquare, piece);
   // does all that extra stuff not directly related to immediate piece movement
   isWhiteTurn = !isWhiteTurn;
+
+  hash ^= zobrist.castling[castleStatus] ^
+          zobristEnPassantKey(enPassantIndex) ^ zobrist.side;
+}
+
+void Board::updateDerivedState() {
+  hash = 0;
+  psqtScore = 0;
+  dirtyCount = 0;
+  materialHash = 0;
+  std::fill(std::begin(pieceCounts), std::end(pieceCounts), 0);
+  pawnHash = 0;
+  kingSquare[0] = kingSquare[1] = -1;
+  for (int i = 0; i < 64; i++) {
+    hash ^= zobristPieceKey(state[i], i);
+
+    int piece = zobristPieceIndex(state[i]);
+    if (piece >= 0) {
+      psqtScore += pieceSquareScores.scores[piece][i];
+      materialHash ^= zobrist.pieces[piece][pieceCounts[piece]++];
+    }
+    if (state[i] == 'P' || state[i] == 'p')
+      pawnHash ^= zobristPieceKey(state[i], i);
+    if (state[i] == 'K' || state[i] == 'k')
+      kingSquare[state[i] == 'K' ? 0 : 1] = i;
+  }
+
+  hash ^= zobrist.castling[castleStatus] ^ zobristEnPassantKey(enPassantIndex);
+  if (!isWhiteTurn)
+    hash ^= zobrist.side;
+}
+
+bool Board::loadFEN(const std::string &fen) {
+  std::istringstream stream(fen);
+  std::string placement, side, castling, enPassant;
+  int halfmoves = 0;
+  if (!(stream >> placement >> side >> castling >> enPassant))
+    return false;
+  if (!(stream >> halfmoves))
+    halfmoves = 0;
+
+  std::string squares(64, '0');
+  int rank = 7, file = 0;
+  for (char c : placement) {
+    if (c == '/') {
+      rank--;
+      file = 0;
+    } else if (isdigit(c)) {
+      file += c - '0';
+    } else if (charToPiece(c) != NoPiece && rank >= 0 && file < 8) {
+      squares[rank * 8 + file++] = c;
+    } else {
+      return false;
+    }
+  }
+  if (side != "w" && side != "b")
+    return false;
+
+  int castles = 0;
+  for (char c : castling) {
+    castles |= c == 'K'   ? CastleStatus::K
+               : c == 'Q' ? CastleStatus::Q
+               : c == 'k' ? CastleStatus::k
+               : c == 'q' ? CastleStatus::q
+                          : 0;
+  }
+
+  int enPassantSquare = 64;
+  if (enPassant != "-") {
+    if (enPassant.size() != 2 || enPassant[0] < 'a' || enPassant[0] > 'h' ||
+        enPassant[1] < '1' || enPassant[1] > '8')
+      return false;
+    enPassantSquare = (enPassant[1] - '1') * 8 + (enPassant[0] - 'a');
+  }
+
+  state = squares;
+  isWhiteTurn = side == "w";
+  castleStatus = castles;
+  enPassantIndex = enPassantSquare;
+  halfmoveClock = halfmoves;
+  updateDerivedState();
+  return true;
+}
+
+bool Board::hasCastlingRights() const {
+  return ((castleStatus & K) && state[4] == 'K' && state[7] == 'R') ||
+         ((castleStatus & Q) && state[4] == 'K' && state[0] == 'R') ||
+         ((castleStatus & k) && state[60] == 'k' && state[63] == 'r') ||
+         ((castleStatus & q) && state[60] == 'k' && state[56] == 'r');
+}
+
+bool Board::hasInsufficientMaterial() const {
+  int minors = 0;
+  int knights = 0;
+  int bishopColors = 0; // bit 0 light squared bishop, bit 1 dark
+
+  for (int i = 0; i < 64; i++) {
+    switch (charToPiece(state[i])) {
+    case Pawn:
+    case Rook:
+    case Queen:
+      return false;
+    case Knight:
+      minors++;
+      knights++;
+      break;
+    case Bishop:
+      minors++;
+      bishopColors |= ((i / 8 + i % 8) % 2 == 0) ? 2 : 1;
+      break;
+    default:
+      break;
+    }
+  }
+
+  // a lone minor can't mate, and neither can any number of bishops that are
+  // all on the same colour
+  if (minors <= 1)
+    return true;
+
+  return knights == 0 && bishopColors != 3;
+}
+
+// only positions with the same side to move and no irreversible move since
+// then can be repeats
+int Board::repetitionCount(const std::vector<uint64_t> &history) const {
+  int count = 0;
+  int end = (int)history.size();
+  int start = std::max(0, end - halfmoveClock);
+
+  for (int i = end - 2; i >= start; i -= 2)
+    if (history[i] == hash)
+      count++;
+
+  return count;
 }
@@ -1,5 +1,8 @@
 #pragma once
+#include <atomic>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 enum ChessPiece {
   NoPiece = 0,
@@ -30,6 +33,24 @@ struct Move {
   }
 };
 
+// expected type of a node in the search tree. the first child of a pv node is
+// another pv node, later children are expected to fail high (cut nodes), and
+// the children of a cut node are expected to fail low (all nodes)
+enum NodeType { PVNode, CutNode, AllNode };
+
+struct SearchContext;
+struct EvalTrace;
+
+// one piece appearing on or disappearing from a square during a move. makeMove
+// records these so the nnue accumulator can be updated instead of rebuilt
+struct DirtyPiece {
+  char piece;
+  int8_t square;
+  bool added;
+};
+
+const int MAX_DIRTY_PIECES = 8;
+
 bool isWhite(char piece);
 ChessPiece charToPiece(char piece);
 bool isSlidingPiece(ChessPiece piece);
@@ -61,21 +82,60 @@ private:
   void setEnpasSquare(int startSquare, bool isWhiteTurn);
   void handleEnpas(int endSquare, bool isWhiteTurn);
   void handlePromotion(int startSquare, int endSquare, bool isWhiteTurn);
+  void setSquare(int index, char piece);
 
   std::vector<Move> GenerateMoves();
 
 public:
   std::vector<Move> GenerateLegalMoves();
   int evaluate(Board *board);
-  int negamax(Board *board, int depth, int alpha, int beta, int playerColor);
+  // same, but gives up after material, piece squares and pawns when those
+  // alone are more than margin outside (alpha, beta). lazy says if it did
+  int evaluate(Board *board, int alpha, int beta, int margin, bool &lazy);
+  // full evaluation with every term written down in trace (see EvalTrace.h)
+  int evaluate(Board *board, EvalTrace &trace);
+  int negamax(Board *board, SearchContext &context, int depth, int alpha,
+              int beta, int playerColor, NodeType nodeType = PVNode);
   Move selectBestMove(Board *board, int depth);
 
   void makeMove(Move move);
+  // recomputes everything derived from state after it was set directly
+  void updateDerivedState();
+  // sets up the position from a fen. the move counters are optional, false
+  // (and the board left alone) if it doesn't parse
+  bool loadFEN(const std::string &fen);
+
+  bool isInCheck();
+  bool hasInsufficientMaterial() const;
+  // castling rights that still mean something, with the king and that rook
+  // both on their starting squares
+  bool hasCastlingRights() const;
+  // how many times this position already occurred, given the hashes of the
+  // positions before it (oldest first)
+  int repetitionCount(const std::vector<uint64_t> &history) const;
 
   std::string state;
   int castleStatus = 15;
   int enPassantIndex = 64;
   bool isWhiteTurn = true;
+  // plies since the last capture or pawn move, for the fifty move rule
+  int halfmoveClock = 0;
+  uint64_t hash = 0;
+  // running material + piece square total (white minus black, packed mg/eg),
+  // kept up to date by setSquare
+  int psqtScore = 0;
+  // how many of each piece (by zobrist index) there are, and a hash of just
+  // those counts for the material table
+  int pieceCounts[12] = {};
+  uint64_t materialHash = 0;
+  // hash of just the pawns, for the pawn hash table
+  uint64_t pawnHash = 0;
+  // white, black. also kept up to date by setSquare
+  int kingSquare[2] = {-1, -1};
+  // what the last makeMove changed
+  DirtyPiece dirty[MAX_DIRTY_PIECES];
+  int dirtyCount = 0;
 };
 
-Move selectBestMove(Board *board, int depth);
+Move selectBestMove(Board *board, int depth,
+                    const std::atomic<bool> *stop = nullptr);
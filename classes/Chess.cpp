@@ -1,5 +1,7 @@
 #include "Chess.h"
 #include "Board.h"
+#include "OpeningBook.h"
+#include "TranspositionTable.h"
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
@@ -11,6 +13,9 @@
 
 const int AI_PLAYER = 1;
 const int HUMAN_PLAYER = -1;
+const int AI_SEARCH_DEPTH = 3;
+// the ai only looks in the opening book this far into the game
+const size_t BOOK_MAX_PLY = 20;
 
 // should realistically be in a different file
 std::vector<std::string> split(const std::string &s, char delim) {
@@ -125,6 +130,9 @@ void Chess::setUpBoard() {
   setGameFromFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR");
   /*setGameFromFEN("4k3/8/8/8/8/8/8/RRBQKBRR");*/
   _board.state = stateString();
+  _board.updateDerivedState();
+  _positionHistory.clear();
+  TT.clear();
 
   generateMoves();
 }
@@ -169,6 +177,11 @@ void Chess::bitMovedFromTo(Bit &bit, BitHolder &src, BitHolder &dst) {
 // free all the memory used by the game on the heap
 //
 void Chess::stopGame() {
+  _searchWorker.cancel();
+  _coopSearch.reset();
+  _aiThinking = false;
+  _pondering = false;
+
   for (int y = 0; y < _gameOptions.rowY; y++) {
     for (int x = 0; x < _gameOptions.rowX; x++) {
       _grid[y][x].destroyBit();
@@ -177,7 +190,8 @@ void Chess::stopGame() {
 }
 
 Player *Chess::checkForWinner() {
-  if (getCurrentMoves().size() != 0) {
+  // no moves without being in check is stalemate, checkForDraw handles that
+  if (getCurrentMoves().size() != 0 || !_board.isInCheck()) {
     return nullptr;
   }
   // current player is loser here, therefore
@@ -189,8 +203,11 @@ Player *Chess::checkForWinner() {
 }
 
 bool Chess::checkForDraw() {
-  // check to see if the board is full
-  return false;
+  if (getCurrentMoves().empty())
+    return !_board.isInCheck();
+
+  return _board.halfmoveClock >= 100 || _board.hasInsufficientMaterial() ||
+         _board.repetitionCount(_positionHistory) >= 2;
 }
 
 const char Chess::bitToPieceNotation(int row, int column) const {
@@ -265,6 +282,8 @@ void Chess::setGameFromFEN(const std::string &string) {
     _board.enPassantIndex = rank * 8 + file;
   }
 
+  _board.halfmoveClock = std::stoi(tokens[4]);
+
   int full_turn = std::stoi(tokens[5]);
   _gameOptions.currentTurnNo += (full_turn - 1) * 2;
   if (_gameOptions.currentTurnNo % 2 == 1)
@@ -385,10 +404,76 @@ void Chess::updateGrid() {
   }
 }
 
+// switching modes mid-search throws the current search away, updateAI starts
+// a new one next frame
+void Chess::setCooperativeSearch(bool cooperative) {
+  if (cooperative == _cooperativeSearch)
+    return;
+
+  _searchWorker.cancel();
+  _coopSearch.reset();
+  _aiThinking = false;
+  _pondering = false;
+  _cooperativeSearch = cooperative;
+}
+
+void Chess::setPondering(bool pondering) {
+  _ponderingEnabled = pondering;
+  if (!pondering)
+    stopPondering();
+}
+
+// after the ai moves, start its next search right away on the position the
+// search expects after the human's reply. only for the threaded search, the
+// cooperative one has nowhere to run in the meantime
+void Chess::startPondering(const SearchLine &line) {
+  if (!_ponderingEnabled || _cooperativeSearch || line.pv.size() < 2)
+    return;
+
+  Move reply = line.pv[1];
+  if (std::find(_moves.begin(), _moves.end(), reply) == _moves.end())
+    return;
+
+  Board board = _board;
+  board.makeMove(reply);
+
+  std::vector<uint64_t> history = _positionHistory;
+  history.push_back(_board.hash);
+  _searchWorker.start(board, AI_SEARCH_DEPTH, history);
+
+  _ponderMove = reply;
+  _pondering = true;
+}
+
+void Chess::stopPondering() {
+  if (!_pondering)
+    return;
+
+  _searchWorker.cancel();
+  _pondering = false;
+}
+
+// plays a move from the opening book instead of searching, if the book has
+// one for this position
+bool Chess::playBookMove() {
+  std::shared_ptr<const OpeningBook> book = activeBook();
+  if (book == nullptr || _positionHistory.size() >= BOOK_MAX_PLY)
+    return false;
+
+  Move move;
+  if (!book->pickMove(_board, _bookRandom(), move))
+    return false;
+
+  makeMove(move);
+  return true;
+}
+
 void Chess::generateMoves() { _moves = _board.GenerateLegalMoves(); }
 
 void Chess::makeMove(Move move) {
+  _positionHistory.push_back(_board.hash);
   _board.makeMove(move);
+  _lastPlayedMove = move;
   if (move.flag != MoveFlag::None ||
       getAIPlayer() == getCurrentPlayer()->playerNumber())
     updateGrid();
@@ -399,10 +484,49 @@ void Chess::makeMove(Move move) {
 
 //
 // this is the function that will be called by the AI
+// called every frame while it's the ai's turn. the first call hands the board
+// to the search thread, later ones just check whether it has a move yet
 //
 void Chess::updateAI() {
   if (_winner != nullptr)
     return;
 
-  makeMove(selectBestMove(&_board, 3));
+  if (!_aiThinking) {
+    // ponder hit: the search that's already running is on this exact
+    // position, so just wait for it (it may even be done already)
+    if (_pondering && _lastPlayedMove == _ponderMove) {
+      _pondering = false;
+      _aiThinking = true;
+      return;
+    }
+    stopPondering();
+
+    if (playBookMove())
+      return;
+
+    if (_cooperativeSearch)
+      _coopSearch = std::make_unique<CooperativeSearch>(
+          _board, AI_SEARCH_DEPTH, CoopBudget{}, _positionHistory);
+    else
+      _searchWorker.start(_board, AI_SEARCH_DEPTH, _positionHistory);
+    _aiThinking = true;
+    return;
+  }
+
+  SearchLine line;
+  if (_cooperativeSearch) {
+    if (!_coopSearch->step())
+      return;
+    line.move = _coopSearch->bestMove();
+    _coopSearch.reset();
+  } else if (!_searchWorker.poll(line)) {
+    return;
+  }
+
+  _aiThinking = false;
+  if (line.move.StartSquare < 0)
+    return;
+
+  makeMove(line.move);
+  startPondering(line);
 }
@@ -1,7 +1,11 @@
 #pragma once
 #include "Board.h"
 #include "ChessSquare.h"
+#include "CooperativeSearch.h"
 #include "Game.h"
+#include "SearchWorker.h"
+#include <memory>
+#include <random>
 #include <string>
 #include <vector>
 
@@ -46,6 +50,16 @@ public:
   std::vector<Move> getCurrentMoves() { return _moves; }
   int getCastlingStatus() { return _board.castleStatus; }
   int getEnPassantIndex() { return _board.enPassantIndex; }
+  const Board &getBoard() { return _board; }
+
+  // search on the ui thread in small per-frame slices instead of on the
+  // search worker thread
+  bool getCooperativeSearch() { return _cooperativeSearch; }
+  void setCooperativeSearch(bool cooperative);
+  // keep searching during the human's turn, on the position after the reply
+  // the last search expected
+  bool getPondering() { return _ponderingEnabled; }
+  void setPondering(bool pondering);
 
 private:
   Bit *PieceForPlayer(const int playerNumber, ChessPiece piece);
@@ -55,8 +69,27 @@ private:
   void setBoardFromFEN(const std::string &string);
   void generateMoves();
   void makeMove(Move move);
+  void startPondering(const SearchLine &line);
+  void stopPondering();
+  bool playBookMove();
 
   ChessSquare _grid[8][8];
   Board _board;
   std::vector<Move> _moves;
+  // hashes of every position before the current one, for repetitions
+  std::vector<uint64_t> _positionHistory;
+
+  SearchWorker _searchWorker;
+  std::unique_ptr<CooperativeSearch> _coopSearch;
+  bool _aiThinking = false;
+  bool _ponderingEnabled = true;
+  bool _pondering = false;
+  Move _ponderMove{-1, -1};
+  Move _lastPlayedMove{-1, -1};
+  std::mt19937_64 _bookRandom{std::random_device{}()};
+#ifdef __EMSCRIPTEN__
+  bool _cooperativeSearch = true;
+#else
+  bool _cooperativeSearch = false;
+#endif
 };
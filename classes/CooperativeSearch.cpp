@@ -0,0 +1,119 @@
+#include "CooperativeSearch.h"
+#include <algorithm>
+
+// below this depth a subtree is small enough to search in one go with the
+// normal recursive negamax instead of paying for a coroutine per node
+const int COOP_MIN_DEPTH = 2;
+
+CooperativeSearch::CooperativeSearch(const Board &board, int depth,
+                                     CoopBudget budget,
+                                     const std::vector<uint64_t> &history)
+    : _budget(budget), _root(iterativeDeepening(board, depth)) {
+  _context.startSearch(board, history);
+  _resumePoint = _root.handle();
+  beginSearchStats(1);
+}
+
+bool CooperativeSearch::step() {
+  if (finished())
+    return true;
+
+  _sliceStartNodes = _context.stats.nodes;
+  _sliceStart = std::chrono::steady_clock::now();
+
+  _resumePoint.resume();
+  return finished();
+}
+
+bool CooperativeSearch::budgetSpent() const {
+  if (_budget.nodes > 0 &&
+      _context.stats.nodes - _sliceStartNodes >= _budget.nodes)
+    return true;
+
+  if (_budget.microseconds > 0) {
+    auto elapsed = std::chrono::steady_clock::now() - _sliceStart;
+    if (std::chrono::duration_cast<std::chrono::microseconds>(elapsed)
+            .count() >= _budget.microseconds)
+      return true;
+  }
+
+  return false;
+}
+
+// same node as Board::negamax, but the children are awaited so the search can
+// be suspended between any two of them
+CoopTask<int> CooperativeSearch::negamax(Board board, int depth, int alpha,
+                                         int beta, NodeType nodeType) {
+  if (depth < COOP_MIN_DEPTH)
+    co_return board.negamax(&board, _context, depth, alpha, beta, 0, nodeType);
+
+  SearchNode node;
+  if (beginNode(&board, _context, node, depth, alpha, beta, nodeType))
+    co_return node.score;
+
+  for (size_t i = 0; i < node.moves.size(); i++) {
+    const Move &move = node.moves[i];
+    Board newBoard = board;
+
+    newBoard.makeMove(move);
+
+    int score = -co_await negamax(newBoard, node.depth - 1, -beta,
+                                  -node.alpha, childNodeType(nodeType, i));
+
+    if (updateNode(&board, _context, node, move, score, beta))
+      break;
+
+    co_await YieldAwaiter{this};
+  }
+
+  co_return endNode(&board, _context, node, beta);
+}
+
+CoopTask<int> CooperativeSearch::iterativeDeepening(Board board, int depth) {
+  std::vector<Move> rootMoves =
+      generateRootMoves(board, _context.syzygy.get());
+
+  for (int iteration = 1; iteration <= depth && !rootMoves.empty();
+       iteration++) {
+    // previous best first
+    auto it = std::find(rootMoves.begin(), rootMoves.end(), _best.move);
+    if (it != rootMoves.end())
+      std::rotate(rootMoves.begin(), it, it + 1);
+
+    SearchLine line;
+    line.score = -INF;
+    line.depth = iteration;
+    int alpha = -INF;
+
+    for (size_t i = 0; i < rootMoves.size(); i++) {
+      Board newBoard = board;
+      newBoard.makeMove(rootMoves[i]);
+
+      int score = -co_await negamax(newBoard, iteration - 1, -INF, -alpha,
+                                    childNodeType(PVNode, i));
+
+      if (score > line.score) {
+        line.score = score;
+        line.move = rootMoves[i];
+      }
+      alpha = std::max(alpha, score);
+
+      co_await YieldAwaiter{this};
+    }
+
+    _best = line;
+    _context.tt->store(board.hash, line.score, iteration, BoundExact,
+                       line.move);
+
+    SearchStats &stats = _context.stats;
+    publishSearchStats(0, stats);
+    stats.depth = iteration;
+    stats.iterationMs.push_back(stats.elapsedMs);
+    stats.iterationNodes.push_back(stats.nodes);
+    publishSearchStats(0, stats);
+  }
+
+  dumpSearchStats();
+
+  co_return 0;
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include "Board.h"
+#include "Search.h"
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <utility>
+#include <vector>
+
+// a lazily started coroutine that produces a T. co_await'ing one runs it and
+// picks up where we left off once it's done (symmetric transfer, so deep
+// chains of them don't grow the real stack)
+template <typename T> class CoopTask {
+public:
+  struct promise_type {
+    T value{};
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+
+    CoopTask get_return_object() {
+      return CoopTask(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct FinalAwaiter {
+      bool await_ready() noexcept { return false; }
+      std::coroutine_handle<>
+      await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+        return handle.promise().continuation;
+      }
+      void await_resume() noexcept {}
+    };
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    void return_value(T result) { value = std::move(result); }
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  explicit CoopTask(std::coroutine_handle<promise_type> handle)
+      : _handle(handle) {}
+  CoopTask(CoopTask &&other) noexcept
+      : _handle(std::exchange(other._handle, nullptr)) {}
+  CoopTask(const CoopTask &) = delete;
+  CoopTask &operator=(const CoopTask &) = delete;
+  ~CoopTask() {
+    if (_handle)
+      _handle.destroy();
+  }
+
+  bool await_ready() { return false; }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) {
+    _handle.promise().continuation = awaiting;
+    return _handle;
+  }
+  T await_resume() { return std::move(_handle.promise().value); }
+
+  std::coroutine_handle<promise_type> handle() const { return _handle; }
+
+private:
+  std::coroutine_handle<promise_type> _handle;
+};
+
+// how much work one step() may do. zero means no limit on that axis
+struct CoopBudget {
+  uint64_t nodes = 0;
+  int64_t microseconds = 8000;
+};
+
+// the search as a chain of coroutines instead of a recursive call, for builds
+// that have no thread to spare for the ai. every step() searches until the
+// budget runs out and then suspends the whole chain, so the caller can draw a
+// frame and come back for more
+class CooperativeSearch {
+public:
+  CooperativeSearch(const Board &board, int depth, CoopBudget budget = {},
+                    const std::vector<uint64_t> &history = {});
+  // the coroutines point back at this object, so it has to stay put
+  CooperativeSearch(const CooperativeSearch &) = delete;
+  CooperativeSearch &operator=(const CooperativeSearch &) = delete;
+
+  // runs one slice of the search. true once it has finished
+  bool step();
+  bool finished() const { return _root.handle().done(); }
+  // best move of the deepest completed iteration
+  Move bestMove() const { return _best.move; }
+  uint64_t nodes() const { return _context.stats.nodes; }
+
+  // suspends the current coroutine chain if the slice is used up
+  struct YieldAwaiter {
+    CooperativeSearch *search;
+
+    bool await_ready() { return !search->budgetSpent(); }
+    void await_suspend(std::coroutine_handle<> handle) {
+      search->_resumePoint = handle;
+    }
+    void await_resume() {}
+  };
+
+private:
+  CoopTask<int> negamax(Board board, int depth, int alpha, int beta,
+                        NodeType nodeType);
+  CoopTask<int> iterativeDeepening(Board board, int depth);
+  bool budgetSpent() const;
+
+  SearchContext _context;
+  CoopBudget _budget;
+  SearchLine _best;
+
+  uint64_t _sliceStartNodes = 0;
+  std::chrono::steady_clock::time_point _sliceStart;
+
+  std::coroutine_handle<> _resumePoint;
+  CoopTask<int> _root;
+};
@@ -0,0 +1,104 @@
+#include "Endgame.h"
+#include "Material.h"
+#include "PieceSquareTables.h"
+#include <algorithm>
+#include <cstdlib>
+
+static int kingDistance(int a, int b) {
+  return std::max(std::abs(a / 8 - b / 8), std::abs(a % 8 - b % 8));
+}
+
+// 0 in the middle four squares, 3 on the edge
+static int centerDistance(int square) {
+  int rank = square / 8;
+  int file = square % 8;
+  return std::max(3 - std::min(rank, 7 - rank), 3 - std::min(file, 7 - file));
+}
+
+static int relativeRank(int side, int square) {
+  return side == 0 ? square / 8 : 7 - square / 8;
+}
+
+// first square holding piece, -1 if there isn't one
+static int findPiece(const Board &board, char piece) {
+  size_t index = board.state.find(piece);
+  return index == std::string::npos ? -1 : (int)index;
+}
+
+static bool isDarkSquare(int square) {
+  return (square / 8 + square % 8) % 2 == 0;
+}
+
+int evaluateKXK(const Board &board, int strongSide) {
+  int strongKing = board.kingSquare[strongSide];
+  int weakKing = board.kingSquare[1 - strongSide];
+
+  int material = 0;
+  for (int type = Pawn; type < King; type++)
+    material += board.pieceCounts[type - 1 + strongSide * 6] *
+                EG_PIECE_VALUES[type];
+
+  return KNOWN_WIN + material + 30 * centerDistance(weakKing) +
+         10 * (7 - kingDistance(strongKing, weakKing));
+}
+
+int evaluateKBNK(const Board &board, int strongSide) {
+  int strongKing = board.kingSquare[strongSide];
+  int weakKing = board.kingSquare[1 - strongSide];
+  int bishop = findPiece(board, strongSide == 0 ? 'B' : 'b');
+
+  // a1 and h8 are dark
+  int cornerA = isDarkSquare(bishop) ? 0 : 7;
+  int cornerB = isDarkSquare(bishop) ? 63 : 56;
+  int cornerDistance = std::min(kingDistance(weakKing, cornerA),
+                                kingDistance(weakKing, cornerB));
+
+  return KNOWN_WIN + EG_PIECE_VALUES[Bishop] + EG_PIECE_VALUES[Knight] +
+         40 * (7 - cornerDistance) +
+         10 * (7 - kingDistance(strongKing, weakKing));
+}
+
+int evaluateKRKP(const Board &board, int strongSide) {
+  int weakSide = 1 - strongSide;
+  int strongKing = board.kingSquare[strongSide];
+  int weakKing = board.kingSquare[weakSide];
+  int rook = findPiece(board, strongSide == 0 ? 'R' : 'r');
+  int pawn = findPiece(board, weakSide == 0 ? 'P' : 'p');
+
+  int push = weakSide == 0 ? 8 : -8;
+  int queeningSquare = pawn % 8 + (weakSide == 0 ? 56 : 0);
+  bool strongToMove = board.isWhiteTurn == (strongSide == 0);
+
+  // our king stands in the pawn's way
+  bool inFront =
+      strongKing % 8 == pawn % 8 &&
+      relativeRank(weakSide, strongKing) > relativeRank(weakSide, pawn);
+
+  if (inFront)
+    return EG_PIECE_VALUES[Rook] - kingDistance(strongKing, pawn);
+
+  // their king is too far away to help the pawn
+  if (kingDistance(weakKing, pawn) >= 3 + (strongToMove ? 0 : 1) &&
+      kingDistance(weakKing, rook) >= 3)
+    return EG_PIECE_VALUES[Rook] - kingDistance(strongKing, pawn);
+
+  // pawn far advanced with its king next to it and ours cut off, likely a draw
+  if (relativeRank(strongSide, weakKing) <= 2 &&
+      kingDistance(weakKing, pawn) == 1 &&
+      relativeRank(strongSide, strongKing) >= 3 &&
+      kingDistance(strongKing, pawn) > 2 + (strongToMove ? 1 : 0))
+    return 80 - 8 * kingDistance(strongKing, pawn);
+
+  return 200 - 8 * (kingDistance(strongKing, pawn + push) -
+                    kingDistance(weakKing, pawn + push) -
+                    kingDistance(pawn, queeningSquare));
+}
+
+int scaleOppositeBishops(const Board &board, int strongSide) {
+  int white = findPiece(board, 'B');
+  int black = findPiece(board, 'b');
+
+  if (isDarkSquare(white) == isDarkSquare(black))
+    return SCALE_NORMAL;
+  return 24;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "Board.h"
+
+// a score that's clearly winning but still well below any mate score
+const int KNOWN_WIN = 10000;
+
+// endgames that the regular evaluation plays badly. each one scores the
+// position from strongSide's point of view
+
+// king and rook or queen (plus anything) against a bare king: drive the king
+// to the edge and bring ours closer
+int evaluateKXK(const Board &board, int strongSide);
+// king, bishop and knight against a bare king: the mate only works in a corner
+// the bishop can cover
+int evaluateKBNK(const Board &board, int strongSide);
+// king and rook against king and pawn: won unless the pawn is far enough
+// advanced and well supported
+int evaluateKRKP(const Board &board, int strongSide);
+
+// bishops on opposite colours with only pawns otherwise are very drawish
+int scaleOppositeBishops(const Board &board, int strongSide);
@@ -0,0 +1,26 @@
+#include "EvalCache.h"
+
+EvalCache::EvalCache(size_t entries) {
+  size_t count = 1;
+  while (count * 2 <= entries)
+    count *= 2;
+
+  _entries = std::make_unique<Entry[]>(count);
+  _mask = count - 1;
+}
+
+// direct mapped, a new position just replaces whatever was in its slot
+bool EvalCache::probe(uint64_t key, int &score) const {
+  const Entry &entry = _entries[key & _mask];
+  if (entry.key != key)
+    return false;
+
+  score = entry.score;
+  return true;
+}
+
+void EvalCache::store(uint64_t key, int score) {
+  Entry &entry = _entries[key & _mask];
+  entry.key = key;
+  entry.score = score;
+}
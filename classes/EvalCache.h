@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// static evaluations of positions already seen in this search, by hash. the
+// same position comes up again through transpositions and on every iteration,
+// and the evaluation is a lot more than a lookup now.
+//
+// every search thread has its own, so unlike the transposition table nothing
+// here has to be atomic
+class EvalCache {
+public:
+  explicit EvalCache(size_t entries = 1 << 14);
+
+  bool probe(uint64_t key, int &score) const;
+  void store(uint64_t key, int score);
+
+private:
+  struct Entry {
+    uint64_t key = 0;
+    int score = 0;
+  };
+
+  std::unique_ptr<Entry[]> _entries;
+  size_t _mask = 0;
+};
@@ -0,0 +1,58 @@
+#include "EvalTrace.h"
+#include "Material.h"
+#include "PieceSquareTables.h"
+#include <cstdio>
+
+static const char *TERM_NAMES[EVAL_TERMS] = {
+    "material",      "piece squares", "imbalance",    "passed pawns",
+    "doubled pawns", "isolated pawns", "backward pawns", "king shelter",
+    "mobility",      "king safety",   "pawn threats", "hanging pieces",
+    "space"};
+
+std::string EvalTrace::toString() const {
+  char line[128];
+  std::string out;
+
+  snprintf(line, sizeof(line), "%-15s %13s %13s %13s\n", "term", "white",
+           "black", "total");
+  out += line;
+  snprintf(line, sizeof(line), "%-15s %6s %6s %6s %6s %6s %6s\n", "", "mg",
+           "eg", "mg", "eg", "mg", "eg");
+  out += line;
+
+  int total = 0;
+  for (int term = 0; term < EVAL_TERMS; term++) {
+    int white = terms[term][0];
+    int black = terms[term][1];
+    snprintf(line, sizeof(line), "%-15s %6d %6d %6d %6d %6d %6d\n",
+             TERM_NAMES[term], mgValue(white), egValue(white), mgValue(black),
+             egValue(black), mgValue(white - black), egValue(white - black));
+    out += line;
+    total += white - black;
+  }
+
+  snprintf(line, sizeof(line), "%-15s %34d %6d\n", "sum", mgValue(total),
+           egValue(total));
+  out += line;
+  snprintf(line, sizeof(line), "phase %d/%d, endgame scale %d/%d%s\n", phase,
+           MAX_PHASE, scaleFactor, SCALE_NORMAL,
+           endgame ? ", known endgame" : "");
+  out += line;
+  snprintf(line, sizeof(line), "score %d (white's side)\n", score);
+  out += line;
+  return out;
+}
+
+std::string traceEvaluation(const Board &board) {
+  Board copy = board;
+  EvalTrace trace;
+  copy.evaluate(&copy, trace);
+  return trace.toString();
+}
+
+std::string traceEvaluation(const std::string &fen) {
+  Board board;
+  if (!board.loadFEN(fen))
+    return "";
+  return traceEvaluation(board);
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "Board.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// every term of the handcrafted evaluation, for breaking a score down
+enum EvalTerm {
+  TermMaterial,
+  TermPieceSquares,
+  TermImbalance,
+  TermPassedPawns,
+  TermDoubledPawns,
+  TermIsolatedPawns,
+  TermBackwardPawns,
+  TermKingShelter,
+  TermMobility,
+  TermKingSafety,
+  TermPawnThreats,
+  TermHangingPieces,
+  TermSpace,
+  EVAL_TERMS
+};
+
+// the linear parameters of the terms above (classes/EvalParameters.h), as
+// indices into EvalTrace::counts. the ones that stand for a whole table are
+// followed by its other entries
+enum EvalParam {
+  // by how far the pawn has advanced
+  ParamPassedPawn,
+  ParamDoubledPawn = ParamPassedPawn + 8,
+  ParamIsolatedPawn,
+  ParamBackwardPawn,
+  // by distance from the king to its closest shield pawn, middlegame only
+  ParamShield,
+  ParamNoShield = ParamShield + 4,
+  // by ChessPiece, counting safe squares above or below the usual number
+  ParamMobility,
+  ParamPawnThreat = ParamMobility + 7,
+  ParamHangingPiece,
+  ParamSpace,
+  EVAL_PARAMS
+};
+
+// a piece the material and piece square terms counted. tableSquare indexes the
+// piece square tables (a8 first), which is what the tuner fits
+struct TracedPiece {
+  int8_t side;
+  int8_t type;
+  int8_t tableSquare;
+};
+
+// what a traced evaluation added up. each side's terms are from its own point
+// of view (a penalty is negative for either side), packed mg/eg
+struct EvalTrace {
+  int terms[EVAL_TERMS][2] = {};
+  // how many times each side got every parameter, so the terms they make up
+  // are counts[param][side] * value. the tuner fits the values from these
+  int counts[EVAL_PARAMS][2] = {};
+  int phase = 0;
+  // out of SCALE_NORMAL, applied to the endgame half
+  int scaleFactor = 0;
+  // scored by a known endgame function, the terms are empty then
+  bool endgame = false;
+  // the final score, from white's side
+  int score = 0;
+  std::vector<TracedPiece> pieces;
+
+  void add(EvalTerm term, int side, int value) { terms[term][side] += value; }
+  void count(int param, int side, int times) { counts[param][side] += times; }
+  std::string toString() const;
+};
+
+// the evaluation code is instantiated with Trace false for the search and true
+// for tracing, so the normal one doesn't even test for a trace
+template <bool Trace>
+inline void traceTerm(EvalTrace *trace, EvalTerm term, int side, int value) {
+  if constexpr (Trace)
+    trace->add(term, side, value);
+}
+
+template <bool Trace>
+inline void traceCount(EvalTrace *trace, int param, int side, int times = 1) {
+  if constexpr (Trace)
+    trace->count(param, side, times);
+}
+
+// evaluation of the board broken down by term, as a printable table
+std::string traceEvaluation(const Board &board);
+// same for a fen, empty if it doesn't parse
+std::string traceEvaluation(const std::string &fen);
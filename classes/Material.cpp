@@ -0,0 +1,142 @@
+#include "Material.h"
+#include "Endgame.h"
+#include "PieceSquareTables.h"
+#include <algorithm>
+
+const int BISHOP_PAIR = makeScore(30, 50);
+const int KNIGHT_PAIR = makeScore(-8, -8);
+const int ROOK_PAIR = makeScore(-12, -16);
+// knights get better and rooks worse the more pawns there are, per pawn away
+// from five
+const int KNIGHT_PER_PAWN = makeScore(3, 3);
+const int ROOK_PER_PAWN = makeScore(-6, -6);
+
+static int count(const int *counts, int side, ChessPiece piece) {
+  return counts[piece - 1 + side * 6];
+}
+
+// non pawn material, mg values
+static int nonPawnMaterial(const int *counts, int side) {
+  int material = 0;
+  for (int type = Knight; type < King; type++)
+    material += count(counts, side, (ChessPiece)type) * MG_PIECE_VALUES[type];
+  return material;
+}
+
+static bool isBareKing(const int *counts, int side) {
+  for (int type = Pawn; type < King; type++)
+    if (count(counts, side, (ChessPiece)type) != 0)
+      return false;
+  return true;
+}
+
+static int imbalance(const int *counts, int side) {
+  int pawns = count(counts, side, Pawn);
+  int knights = count(counts, side, Knight);
+  int rooks = count(counts, side, Rook);
+  int score = 0;
+
+  if (count(counts, side, Bishop) >= 2)
+    score += BISHOP_PAIR;
+  if (knights >= 2)
+    score += KNIGHT_PAIR;
+  if (rooks >= 2)
+    score += ROOK_PAIR;
+
+  score += knights * (pawns - 5) * KNIGHT_PER_PAWN;
+  score += rooks * (pawns - 5) * ROOK_PER_PAWN;
+  return score;
+}
+
+static void computeEntry(MaterialEntry &entry, const int *counts) {
+  entry.phase = 0;
+  for (int side = 0; side < 2; side++)
+    for (int type = Pawn; type < King; type++)
+      entry.phase +=
+          count(counts, side, (ChessPiece)type) * PHASE_WEIGHTS[type];
+  // promotions can push the phase past the starting material
+  entry.phase = std::min(entry.phase, MAX_PHASE);
+
+  entry.imbalance = imbalance(counts, 0) - imbalance(counts, 1);
+
+  for (int side = 0; side < 2; side++) {
+    int weak = 1 - side;
+    int npm = nonPawnMaterial(counts, side);
+
+    if (isBareKing(counts, weak)) {
+      bool bishopKnight =
+          npm == MG_PIECE_VALUES[Bishop] + MG_PIECE_VALUES[Knight] &&
+          count(counts, side, Bishop) == 1 && count(counts, side, Pawn) == 0;
+      if (bishopKnight) {
+        entry.endgame = evaluateKBNK;
+        entry.strongSide = side;
+      } else if (count(counts, side, Rook) + count(counts, side, Queen) > 0) {
+        entry.endgame = evaluateKXK;
+        entry.strongSide = side;
+      }
+    }
+
+    if (npm == MG_PIECE_VALUES[Rook] && count(counts, side, Rook) == 1 &&
+        count(counts, side, Pawn) == 0 && count(counts, weak, Pawn) == 1 &&
+        nonPawnMaterial(counts, weak) == 0) {
+      entry.endgame = evaluateKRKP;
+      entry.strongSide = side;
+    }
+
+    // without pawns being a minor piece up is rarely enough to win
+    int weakNpm = nonPawnMaterial(counts, weak);
+    if (count(counts, side, Pawn) == 0 &&
+        npm - weakNpm <= MG_PIECE_VALUES[Bishop]) {
+      if (npm < MG_PIECE_VALUES[Rook])
+        entry.scale[side] = SCALE_DRAW;
+      else
+        entry.scale[side] = weakNpm <= MG_PIECE_VALUES[Bishop] ? 4 : 14;
+    }
+  }
+
+  bool onlyBishops = true;
+  for (int side = 0; side < 2; side++)
+    onlyBishops = onlyBishops && count(counts, side, Bishop) == 1 &&
+                  nonPawnMaterial(counts, side) == MG_PIECE_VALUES[Bishop];
+  if (onlyBishops)
+    entry.scaleFunction[0] = entry.scaleFunction[1] = scaleOppositeBishops;
+}
+
+int MaterialEntry::scaleFactor(const Board &board, int strongSide) const {
+  if (scaleFunction[strongSide] != nullptr) {
+    int scaled = scaleFunction[strongSide](board, strongSide);
+    return std::min(scaled, scale[strongSide]);
+  }
+  return scale[strongSide];
+}
+
+MaterialTable::MaterialTable(size_t entries) {
+  size_t count = 1;
+  while (count * 2 <= entries)
+    count *= 2;
+
+  _entries = std::make_unique<MaterialEntry[]>(count);
+  _mask = count - 1;
+}
+
+// the kings are counted too, so no real board has key 0 and an empty slot
+// never matches
+const MaterialEntry &MaterialTable::probe(const Board &board) {
+  MaterialEntry &entry = _entries[board.materialHash & _mask];
+  if (entry.key == board.materialHash)
+    return entry;
+
+  entry = MaterialEntry();
+  entry.key = board.materialHash;
+  computeEntry(entry, board.pieceCounts);
+  return entry;
+}
+
+const MaterialEntry &probeMaterial(const Board &board) {
+  static thread_local MaterialTable table;
+  return table.probe(board);
+}
+
+int materialImbalance(const Board &board, int side) {
+  return imbalance(board.pieceCounts, side);
+}
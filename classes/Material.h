@@ -0,0 +1,52 @@
+#pragma once
+#include "Board.h"
+#include <cstdint>
+#include <memory>
+
+// scale factors for the endgame half of the score, out of SCALE_NORMAL
+const int SCALE_NORMAL = 64;
+const int SCALE_DRAW = 0;
+
+// both of these score from strongSide's point of view (0 white, 1 black)
+using EndgameFunction = int (*)(const Board &board, int strongSide);
+using ScaleFunction = int (*)(const Board &board, int strongSide);
+
+// everything the evaluation needs that only depends on how many of each piece
+// there are, computed once per material signature (Board::materialHash)
+struct MaterialEntry {
+  uint64_t key = 0;
+  int phase = 0;
+  // bishop pair, redundant knights/rooks, piece values shifting with the
+  // number of pawns. packed mg/eg from white's side
+  int imbalance = 0;
+
+  // known endgames are scored by their own function instead of the usual
+  // evaluation
+  EndgameFunction endgame = nullptr;
+  int strongSide = 0;
+
+  // how much of the endgame score to keep when each side is the one ahead,
+  // either fixed or worked out by a function that looks at the board
+  int scale[2] = {SCALE_NORMAL, SCALE_NORMAL};
+  ScaleFunction scaleFunction[2] = {nullptr, nullptr};
+
+  int scaleFactor(const Board &board, int strongSide) const;
+};
+
+// there are only so many material signatures in a search, so this is small.
+// each thread gets its own, like the pawn hash
+class MaterialTable {
+public:
+  explicit MaterialTable(size_t entries = 1024);
+
+  const MaterialEntry &probe(const Board &board);
+
+private:
+  std::unique_ptr<MaterialEntry[]> _entries;
+  size_t _mask = 0;
+};
+
+// the entry for board from the calling thread's table
+const MaterialEntry &probeMaterial(const Board &board);
+// one side's part of MaterialEntry::imbalance, for tracing
+int materialImbalance(const Board &board, int side);
@@ -1,4 +1,6 @@
 #include "Board.h"
+#include "Attacks.h"
+#include <array>
 #include <vector>
 
 const int directional_offsets[] = {8, -8, -1, 1, 7, -7, 9, -9};
@@ -62,6 +64,16 @@ std::vector<Move> Board::GenerateLegalMoves() {
   return legalMoves;
 }
 
+// whether the side to move's king is attacked right now. the attack maps are
+// usually already there from ordering or evaluating this position
+bool Board::isInCheck() {
+  int side = isWhiteTurn ? 0 : 1;
+  if (kingSquare[side] < 0)
+    return false;
+
+  return attacksFor(*this).isAttacked(kingSquare[side], 1 - side);
+}
+
 std::vector<Move> Board::GenerateMoves() {
   std::vector<Move> moves;
   for (int i = 0; i < 64; i++) {
@@ -0,0 +1,275 @@
+#include "NNUE.h"
+#include "NNUEKernels.h"
+#include "Search.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#define NNUE_USE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char NNUE_MAGIC[8] = {'C', 'H', 'S', 'N', 'N', 'U', 'E', '1'};
+
+static std::mutex networkMutex;
+static std::shared_ptr<Network> loadedNetwork;
+static bool useNetwork = false;
+
+// each side sees the board from its own end, so black's squares are flipped
+static int orient(int perspective, int square) {
+  return perspective == 0 ? square : square ^ 56;
+}
+
+static int featureIndex(int perspective, int kingSquare, char piece,
+                        int square) {
+  int color = isupper(piece) ? 0 : 1;
+  int pieceIndex = (charToPiece(piece) - 1) * 2 + (color != perspective);
+  return orient(perspective, kingSquare) * NNUE_PIECE_FEATURES + 1 +
+         pieceIndex * 64 + orient(perspective, square);
+}
+
+static bool isKing(char piece) { return piece == 'K' || piece == 'k'; }
+
+std::shared_ptr<Network> Network::load(const std::string &path) {
+  std::shared_ptr<Network> network(new Network());
+
+#ifdef NNUE_USE_MMAP
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return nullptr;
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+    close(fd);
+    return nullptr;
+  }
+
+  void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED)
+    return nullptr;
+
+  network->_mapping = mapping;
+  network->_mappingSize = info.st_size;
+  if (!network->mapWeights((const char *)mapping, info.st_size))
+    return nullptr;
+#else
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return nullptr;
+
+  network->_buffer.assign(std::istreambuf_iterator<char>(file),
+                          std::istreambuf_iterator<char>());
+  if (!network->mapWeights(network->_buffer.data(), network->_buffer.size()))
+    return nullptr;
+#endif
+
+  return network;
+}
+
+Network::~Network() {
+#ifdef NNUE_USE_MMAP
+  if (_mapping != nullptr)
+    munmap(_mapping, _mappingSize);
+#endif
+}
+
+// points the weights into the file. every section starts at a multiple of its
+// element size as long as the dimensions are the ones we expect
+bool Network::mapWeights(const char *data, size_t size) {
+  const uint32_t expected[4] = {NNUE_INPUTS, NNUE_HIDDEN, NNUE_L2, NNUE_L3};
+  size_t headerSize = sizeof(NNUE_MAGIC) + sizeof(expected);
+  if (size < headerSize || memcmp(data, NNUE_MAGIC, sizeof(NNUE_MAGIC)) != 0 ||
+      memcmp(data + sizeof(NNUE_MAGIC), expected, sizeof(expected)) != 0)
+    return false;
+
+  size_t offset = headerSize;
+  auto take = [&](size_t bytes) {
+    const char *section = data + offset;
+    offset += bytes;
+    return section;
+  };
+
+  ftBias = (const int16_t *)take(sizeof(int16_t) * NNUE_HIDDEN);
+  ftWeights =
+      (const int16_t *)take(sizeof(int16_t) * NNUE_INPUTS * NNUE_HIDDEN);
+  l1Bias = (const int32_t *)take(sizeof(int32_t) * NNUE_L2);
+  l1Weights = (const int8_t *)take(NNUE_L2 * 2 * NNUE_HIDDEN);
+  l2Bias = (const int32_t *)take(sizeof(int32_t) * NNUE_L3);
+  l2Weights = (const int8_t *)take(NNUE_L3 * NNUE_L2);
+  const char *outBiasData = take(sizeof(int32_t));
+  outWeights = (const int8_t *)take(NNUE_L3);
+
+  if (offset != size)
+    return false;
+
+  memcpy(&outBias, outBiasData, sizeof(outBias));
+  return true;
+}
+
+static void refresh(const Network &network, const Board &board,
+                    Accumulator &accumulator, int perspective) {
+  const NNUEKernels &kernels = nnueKernels();
+  int16_t *values = accumulator.values[perspective];
+  int king = board.kingSquare[perspective];
+  std::copy(network.ftBias, network.ftBias + NNUE_HIDDEN, values);
+
+  for (int square = 0; square < 64; square++) {
+    char piece = board.state[square];
+    if (piece == '0' || isKing(piece))
+      continue;
+
+    const int16_t *column =
+        network.ftWeights +
+        (size_t)featureIndex(perspective, king, piece, square) * NNUE_HIDDEN;
+    kernels.addColumn(values, column);
+  }
+
+  accumulator.computed[perspective] = true;
+}
+
+void AccumulatorStack::reset(const Network &network, const Board &root) {
+  if (_entries.empty())
+    _entries.resize(128);
+
+  _entries[0].dirtyCount = 0;
+  refresh(network, root, _entries[0], 0);
+  refresh(network, root, _entries[0], 1);
+}
+
+void AccumulatorStack::push(int ply, const Board &board) {
+  if (ply >= (int)_entries.size())
+    _entries.resize(std::max(128, ply * 2));
+
+  Accumulator &entry = _entries[ply];
+  entry.computed[0] = entry.computed[1] = false;
+  entry.dirtyCount = board.dirtyCount;
+  std::copy(board.dirty, board.dirty + board.dirtyCount, entry.dirty);
+}
+
+// finds the closest ancestor with a computed accumulator and replays the
+// moves since then onto it. when our own king moved every input changes, so
+// then it's cheaper to just start over from the board
+void AccumulatorStack::update(const Network &network, const Board &board,
+                              int ply, int perspective) {
+  char ownKing = perspective == 0 ? 'K' : 'k';
+  int start = ply;
+  while (start > 0 && !_entries[start].computed[perspective]) {
+    const Accumulator &entry = _entries[start];
+    for (int i = 0; i < entry.dirtyCount; i++) {
+      if (entry.dirty[i].piece == ownKing) {
+        refresh(network, board, _entries[ply], perspective);
+        return;
+      }
+    }
+    start--;
+  }
+
+  if (!_entries[start].computed[perspective]) {
+    refresh(network, board, _entries[ply], perspective);
+    return;
+  }
+
+  const NNUEKernels &kernels = nnueKernels();
+  int king = board.kingSquare[perspective];
+  for (int current = start + 1; current <= ply; current++) {
+    Accumulator &entry = _entries[current];
+    int16_t *values = entry.values[perspective];
+    std::copy(_entries[current - 1].values[perspective],
+              _entries[current - 1].values[perspective] + NNUE_HIDDEN, values);
+
+    for (int i = 0; i < entry.dirtyCount; i++) {
+      const DirtyPiece &dirty = entry.dirty[i];
+      if (isKing(dirty.piece))
+        continue;
+
+      const int16_t *column =
+          network.ftWeights +
+          (size_t)featureIndex(perspective, king, dirty.piece, dirty.square) *
+              NNUE_HIDDEN;
+      if (dirty.added)
+        kernels.addColumn(values, column);
+      else
+        kernels.subtractColumn(values, column);
+    }
+
+    entry.computed[perspective] = true;
+  }
+}
+
+static uint8_t clippedRelu(int value) {
+  return (uint8_t)std::clamp(value, 0, 127);
+}
+
+int AccumulatorStack::evaluate(const Network &network, const Board &board,
+                               int ply) {
+  update(network, board, ply, 0);
+  update(network, board, ply, 1);
+
+  // side to move's half first
+  const NNUEKernels &kernels = nnueKernels();
+  const Accumulator &accumulator = _entries[ply];
+  int side = board.isWhiteTurn ? 0 : 1;
+  alignas(64) uint8_t input[2 * NNUE_HIDDEN];
+  kernels.clippedRelu(accumulator.values[side], input, NNUE_HIDDEN);
+  kernels.clippedRelu(accumulator.values[1 - side], input + NNUE_HIDDEN,
+                      NNUE_HIDDEN);
+
+  alignas(64) int32_t sums[NNUE_L2];
+  alignas(64) uint8_t hidden1[NNUE_L2];
+  kernels.affine(input, 2 * NNUE_HIDDEN, network.l1Weights, network.l1Bias,
+                 NNUE_L2, sums);
+  for (int i = 0; i < NNUE_L2; i++)
+    hidden1[i] = clippedRelu(sums[i] >> NNUE_WEIGHT_SHIFT);
+
+  alignas(64) uint8_t hidden2[NNUE_L3];
+  kernels.affine(hidden1, NNUE_L2, network.l2Weights, network.l2Bias, NNUE_L3,
+                 sums);
+  for (int i = 0; i < NNUE_L3; i++)
+    hidden2[i] = clippedRelu(sums[i] >> NNUE_WEIGHT_SHIFT);
+
+  int32_t output = network.outBias;
+  for (int i = 0; i < NNUE_L3; i++)
+    output += network.outWeights[i] * hidden2[i];
+
+  // a bad network mustn't pass for a tablebase or mate score
+  return std::clamp(output / NNUE_OUTPUT_SCALE, -(TB_WIN_BOUND - 1),
+                    TB_WIN_BOUND - 1);
+}
+
+bool loadNetwork(const std::string &path) {
+  std::shared_ptr<Network> network = Network::load(path);
+  if (network == nullptr)
+    return false;
+
+  std::lock_guard<std::mutex> lock(networkMutex);
+  loadedNetwork = network;
+  return true;
+}
+
+bool networkLoaded() {
+  std::lock_guard<std::mutex> lock(networkMutex);
+  return loadedNetwork != nullptr;
+}
+
+void setUseNetwork(bool use) {
+  std::lock_guard<std::mutex> lock(networkMutex);
+  useNetwork = use;
+}
+
+bool getUseNetwork() {
+  std::lock_guard<std::mutex> lock(networkMutex);
+  return useNetwork && loadedNetwork != nullptr;
+}
+
+std::shared_ptr<const Network> activeNetwork() {
+  std::lock_guard<std::mutex> lock(networkMutex);
+  return useNetwork ? loadedNetwork : nullptr;
+}
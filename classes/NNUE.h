@@ -0,0 +1,102 @@
+#pragma once
+#include "Board.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// optional neural network evaluation (halfkp, efficiently updatable).
+//
+// the first layer has one input per (own king square, piece, square) for
+// each side's point of view. only a couple of inputs change per move, so its
+// output (the accumulator) is kept per ply and updated from the parent's
+// instead of recomputed. the small dense layers after it are cheap.
+//
+// network file layout, little endian, read in place from a memory map:
+//   char     magic[8] = "CHSNNUE1"
+//   uint32   inputs, hidden, l2, l3 (must match the constants below)
+//   int16    ftBias[hidden]
+//   int16    ftWeights[inputs][hidden]
+//   int32    l1Bias[l2]
+//   int8     l1Weights[l2][2 * hidden]
+//   int32    l2Bias[l3]
+//   int8     l2Weights[l3][l2]
+//   int32    outBias
+//   int8     outWeights[l3]
+// the output divided by NNUE_OUTPUT_SCALE is the score in centipawns for the
+// side to move
+
+const int NNUE_PIECE_FEATURES = 10 * 64 + 1;
+const int NNUE_INPUTS = 64 * NNUE_PIECE_FEATURES;
+const int NNUE_HIDDEN = 256;
+const int NNUE_L2 = 32;
+const int NNUE_L3 = 32;
+const int NNUE_WEIGHT_SHIFT = 6;
+const int NNUE_OUTPUT_SCALE = 16;
+
+class Network {
+public:
+  // nullptr if the file is missing or doesn't look like a network
+  static std::shared_ptr<Network> load(const std::string &path);
+  ~Network();
+
+  Network(const Network &) = delete;
+  Network &operator=(const Network &) = delete;
+
+  const int16_t *ftBias = nullptr;
+  const int16_t *ftWeights = nullptr;
+  const int32_t *l1Bias = nullptr;
+  const int8_t *l1Weights = nullptr;
+  const int32_t *l2Bias = nullptr;
+  const int8_t *l2Weights = nullptr;
+  int32_t outBias = 0;
+  const int8_t *outWeights = nullptr;
+
+private:
+  Network() = default;
+  bool mapWeights(const char *data, size_t size);
+
+  // either the file is mapped or (where there's no mmap) read into _buffer
+  void *_mapping = nullptr;
+  size_t _mappingSize = 0;
+  std::vector<char> _buffer;
+};
+
+// first layer output for one position, from each side's point of view
+struct Accumulator {
+  alignas(64) int16_t values[2][NNUE_HIDDEN];
+  bool computed[2] = {false, false};
+  // how this ply's position differs from its parent's
+  DirtyPiece dirty[MAX_DIRTY_PIECES];
+  int dirtyCount = 0;
+};
+
+// one accumulator per ply of the current search path
+class AccumulatorStack {
+public:
+  // starts a search from root, computing its accumulator from scratch
+  void reset(const Network &network, const Board &root);
+  // the node at ply was just entered with board, remember what changed
+  void push(int ply, const Board &board);
+
+  // score of board (the position at ply) for the side to move
+  int evaluate(const Network &network, const Board &board, int ply);
+
+private:
+  void update(const Network &network, const Board &board, int ply,
+              int perspective);
+
+  std::vector<Accumulator> _entries;
+};
+
+// loads a network for later searches to use. false if it couldn't be loaded,
+// the previous one (if any) stays
+bool loadNetwork(const std::string &path);
+bool networkLoaded();
+// switches between the network and the handcrafted evaluation. only takes
+// effect with a network loaded, and from the next search on
+void setUseNetwork(bool useNetwork);
+bool getUseNetwork();
+// the network searches should use right now, nullptr for the handcrafted eval
+std::shared_ptr<const Network> activeNetwork();
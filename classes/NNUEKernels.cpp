@@ -0,0 +1,314 @@
+#include "NNUEKernels.h"
+#include "NNUE.h"
+#include <algorithm>
+#include <atomic>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||           \
+    defined(_M_IX86)
+#define NNUE_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// gcc and clang only let us use an instruction set in functions marked for
+// it, msvc lets every function use everything
+#if defined(NNUE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define NNUE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define NNUE_TARGET(isa)
+#endif
+
+static void addColumnScalar(int16_t *values, const int16_t *column) {
+  for (int i = 0; i < NNUE_HIDDEN; i++)
+    values[i] += column[i];
+}
+
+static void subtractColumnScalar(int16_t *values, const int16_t *column) {
+  for (int i = 0; i < NNUE_HIDDEN; i++)
+    values[i] -= column[i];
+}
+
+static void clippedReluScalar(const int16_t *input, uint8_t *output,
+                              int count) {
+  for (int i = 0; i < count; i++)
+    output[i] = (uint8_t)std::clamp((int)input[i], 0, 127);
+}
+
+static void affineScalar(const uint8_t *input, int inputs,
+                         const int8_t *weights, const int32_t *bias,
+                         int outputs, int32_t *output) {
+  for (int i = 0; i < outputs; i++) {
+    const int8_t *row = weights + i * inputs;
+    int32_t sum = bias[i];
+    for (int j = 0; j < inputs; j++)
+      sum += row[j] * input[j];
+    output[i] = sum;
+  }
+}
+
+static const NNUEKernels scalarKernels = {"scalar", addColumnScalar,
+                                          subtractColumnScalar,
+                                          clippedReluScalar, affineScalar};
+
+#ifdef NNUE_X86
+
+// ---- sse4.1 ----
+
+NNUE_TARGET("sse4.1")
+static void addColumnSSE41(int16_t *values, const int16_t *column) {
+  for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(values + i));
+    __m128i c = _mm_loadu_si128((const __m128i *)(column + i));
+    _mm_storeu_si128((__m128i *)(values + i), _mm_add_epi16(v, c));
+  }
+}
+
+NNUE_TARGET("sse4.1")
+static void subtractColumnSSE41(int16_t *values, const int16_t *column) {
+  for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(values + i));
+    __m128i c = _mm_loadu_si128((const __m128i *)(column + i));
+    _mm_storeu_si128((__m128i *)(values + i), _mm_sub_epi16(v, c));
+  }
+}
+
+// packing to int8 saturates to [-128, 127], so only the bottom needs clamping
+NNUE_TARGET("sse4.1")
+static void clippedReluSSE41(const int16_t *input, uint8_t *output,
+                             int count) {
+  const __m128i zero = _mm_setzero_si128();
+  for (int i = 0; i < count; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(input + i));
+    __m128i b = _mm_loadu_si128((const __m128i *)(input + i + 8));
+    __m128i packed = _mm_packs_epi16(a, b);
+    _mm_storeu_si128((__m128i *)(output + i), _mm_max_epi8(packed, zero));
+  }
+}
+
+// maddubs multiplies unsigned inputs by signed weights and adds neighbouring
+// pairs into int16. with inputs at most 127 a pair can't saturate
+NNUE_TARGET("sse4.1")
+static void affineSSE41(const uint8_t *input, int inputs, const int8_t *weights,
+                        const int32_t *bias, int outputs, int32_t *output) {
+  const __m128i ones = _mm_set1_epi16(1);
+  for (int i = 0; i < outputs; i++) {
+    const int8_t *row = weights + i * inputs;
+    __m128i sum = _mm_setzero_si128();
+    for (int j = 0; j < inputs; j += 16) {
+      __m128i in = _mm_loadu_si128((const __m128i *)(input + j));
+      __m128i w = _mm_loadu_si128((const __m128i *)(row + j));
+      __m128i products = _mm_maddubs_epi16(in, w);
+      sum = _mm_add_epi32(sum, _mm_madd_epi16(products, ones));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    output[i] = bias[i] + _mm_cvtsi128_si32(sum);
+  }
+}
+
+static const NNUEKernels sse41Kernels = {"sse4.1", addColumnSSE41,
+                                         subtractColumnSSE41, clippedReluSSE41,
+                                         affineSSE41};
+
+// ---- avx2 ----
+
+NNUE_TARGET("avx2")
+static void addColumnAVX2(int16_t *values, const int16_t *column) {
+  for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(values + i));
+    __m256i c = _mm256_loadu_si256((const __m256i *)(column + i));
+    _mm256_storeu_si256((__m256i *)(values + i), _mm256_add_epi16(v, c));
+  }
+}
+
+NNUE_TARGET("avx2")
+static void subtractColumnAVX2(int16_t *values, const int16_t *column) {
+  for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(values + i));
+    __m256i c = _mm256_loadu_si256((const __m256i *)(column + i));
+    _mm256_storeu_si256((__m256i *)(values + i), _mm256_sub_epi16(v, c));
+  }
+}
+
+// the 256 bit pack works per 128 bit lane, the permute puts the halves back
+// in order
+NNUE_TARGET("avx2")
+static void clippedReluAVX2(const int16_t *input, uint8_t *output, int count) {
+  const __m256i zero = _mm256_setzero_si256();
+  for (int i = 0; i < count; i += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(input + i));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(input + i + 16));
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(a, b), 0xD8);
+    _mm256_storeu_si256((__m256i *)(output + i), _mm256_max_epi8(packed, zero));
+  }
+}
+
+NNUE_TARGET("avx2")
+static void affineAVX2(const uint8_t *input, int inputs, const int8_t *weights,
+                       const int32_t *bias, int outputs, int32_t *output) {
+  const __m256i ones = _mm256_set1_epi16(1);
+  for (int i = 0; i < outputs; i++) {
+    const int8_t *row = weights + i * inputs;
+    __m256i sum = _mm256_setzero_si256();
+    for (int j = 0; j < inputs; j += 32) {
+      __m256i in = _mm256_loadu_si256((const __m256i *)(input + j));
+      __m256i w = _mm256_loadu_si256((const __m256i *)(row + j));
+      __m256i products = _mm256_maddubs_epi16(in, w);
+      sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum),
+                                 _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+    output[i] = bias[i] + _mm_cvtsi128_si32(half);
+  }
+}
+
+static const NNUEKernels avx2Kernels = {"avx2", addColumnAVX2,
+                                        subtractColumnAVX2, clippedReluAVX2,
+                                        affineAVX2};
+
+// ---- avx-512 (bw) ----
+
+// gcc 12's own avx512fintrin.h trips -Wmaybe-uninitialized in the permute
+// and reduce intrinsics, nothing in here is actually uninitialized
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+NNUE_TARGET("avx512f,avx512bw")
+static void addColumnAVX512(int16_t *values, const int16_t *column) {
+  for (int i = 0; i < NNUE_HIDDEN; i += 32) {
+    __m512i v = _mm512_loadu_si512(values + i);
+    __m512i c = _mm512_loadu_si512(column + i);
+    _mm512_storeu_si512(values + i, _mm512_add_epi16(v, c));
+  }
+}
+
+NNUE_TARGET("avx512f,avx512bw")
+static void subtractColumnAVX512(int16_t *values, const int16_t *column) {
+  for (int i = 0; i < NNUE_HIDDEN; i += 32) {
+    __m512i v = _mm512_loadu_si512(values + i);
+    __m512i c = _mm512_loadu_si512(column + i);
+    _mm512_storeu_si512(values + i, _mm512_sub_epi16(v, c));
+  }
+}
+
+NNUE_TARGET("avx512f,avx512bw")
+static void clippedReluAVX512(const int16_t *input, uint8_t *output,
+                              int count) {
+  const __m512i zero = _mm512_setzero_si512();
+  const __m512i order = _mm512_setr_epi64(0, 2, 4, 6, 1, 3, 5, 7);
+  for (int i = 0; i < count; i += 64) {
+    __m512i a = _mm512_loadu_si512(input + i);
+    __m512i b = _mm512_loadu_si512(input + i + 32);
+    __m512i packed =
+        _mm512_permutexvar_epi64(order, _mm512_packs_epi16(a, b));
+    _mm512_storeu_si512(output + i, _mm512_max_epi8(packed, zero));
+  }
+}
+
+// the hidden layers are only 32 wide, less than one register, those go to
+// the avx2 version
+NNUE_TARGET("avx512f,avx512bw,avx2")
+static void affineAVX512(const uint8_t *input, int inputs,
+                         const int8_t *weights, const int32_t *bias,
+                         int outputs, int32_t *output) {
+  if (inputs % 64 != 0) {
+    affineAVX2(input, inputs, weights, bias, outputs, output);
+    return;
+  }
+
+  const __m512i ones = _mm512_set1_epi16(1);
+  for (int i = 0; i < outputs; i++) {
+    const int8_t *row = weights + i * inputs;
+    __m512i sum = _mm512_setzero_si512();
+    for (int j = 0; j < inputs; j += 64) {
+      __m512i in = _mm512_loadu_si512(input + j);
+      __m512i w = _mm512_loadu_si512(row + j);
+      __m512i products = _mm512_maddubs_epi16(in, w);
+      sum = _mm512_add_epi32(sum, _mm512_madd_epi16(products, ones));
+    }
+    output[i] = bias[i] + _mm512_reduce_add_epi32(sum);
+  }
+}
+
+static const NNUEKernels avx512Kernels = {"avx512", addColumnAVX512,
+                                          subtractColumnAVX512,
+                                          clippedReluAVX512, affineAVX512};
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+struct CpuFeatures {
+  bool sse41 = false;
+  bool avx2 = false;
+  bool avx512 = false;
+};
+
+static CpuFeatures detectCpuFeatures() {
+  CpuFeatures features;
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 0);
+  int maxLeaf = info[0];
+
+  __cpuid(info, 1);
+  features.sse41 = (info[2] >> 19) & 1;
+  bool osxsave = (info[2] >> 27) & 1;
+  // the os has to save the wider registers on context switches too
+  unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+  bool ymm = (xcr0 & 0x6) == 0x6;
+  bool zmm = (xcr0 & 0xE6) == 0xE6;
+
+  if (maxLeaf >= 7) {
+    __cpuidex(info, 7, 0);
+    features.avx2 = ymm && ((info[1] >> 5) & 1);
+    features.avx512 = zmm && ((info[1] >> 16) & 1) && ((info[1] >> 30) & 1);
+  }
+#else
+  __builtin_cpu_init();
+  features.sse41 = __builtin_cpu_supports("sse4.1");
+  features.avx2 = __builtin_cpu_supports("avx2");
+  features.avx512 = __builtin_cpu_supports("avx512f") &&
+                    __builtin_cpu_supports("avx512bw");
+#endif
+  return features;
+}
+
+static const NNUEKernels *detectKernels() {
+  CpuFeatures features = detectCpuFeatures();
+  if (features.avx512)
+    return &avx512Kernels;
+  if (features.avx2)
+    return &avx2Kernels;
+  if (features.sse41)
+    return &sse41Kernels;
+  return &scalarKernels;
+}
+
+#else
+
+static const NNUEKernels *detectKernels() { return &scalarKernels; }
+
+#endif
+
+static const NNUEKernels *bestKernels() {
+  static const NNUEKernels *best = detectKernels();
+  return best;
+}
+
+static std::atomic<bool> scalarOnly = false;
+
+const NNUEKernels &nnueKernels() {
+  return scalarOnly.load(std::memory_order_relaxed) ? scalarKernels
+                                                    : *bestKernels();
+}
+
+const NNUEKernels &scalarNNUEKernels() { return scalarKernels; }
+
+void forceScalarNNUEKernels(bool scalar) { scalarOnly = scalar; }
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+
+// the inner loops of the network, one set per instruction set. the best one
+// the cpu supports is picked the first time they're needed, the scalar set is
+// always there as the reference the others have to match
+struct NNUEKernels {
+  const char *name;
+
+  // values[i] += column[i] (or -=) for a whole accumulator (NNUE_HIDDEN)
+  void (*addColumn)(int16_t *values, const int16_t *column);
+  void (*subtractColumn)(int16_t *values, const int16_t *column);
+
+  // clamps to [0, 127]. count is a multiple of 64
+  void (*clippedRelu)(const int16_t *input, uint8_t *output, int count);
+
+  // output[i] = bias[i] + sum(weights[i][j] * input[j]), weights row major.
+  // inputs is a multiple of 32 and every input is at most 127
+  void (*affine)(const uint8_t *input, int inputs, const int8_t *weights,
+                 const int32_t *bias, int outputs, int32_t *output);
+};
+
+const NNUEKernels &nnueKernels();
+const NNUEKernels &scalarNNUEKernels();
+// for checking the vector kernels against the scalar ones
+void forceScalarNNUEKernels(bool scalar);
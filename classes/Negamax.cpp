@@ -1,120 +1,786 @@
 #include "Board.h"
+#include "Attacks.h"
+#include "EvalTrace.h"
+#include "Material.h"
+#include "PawnHash.h"
+#include "PieceSquareTables.h"
+#include "Search.h"
+#include "Tablebase.h"
+#include "TranspositionTable.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <functional>
+#include <memory>
+#include <thread>
 
-// these correlate to values from ChessPiece
-const int PIECE_VALUES[] = {
-    0,    // NoPiece
-    100,  // Pawn
-    320,  // Knight
-    330,  // Bishop
-    500,  // Rook
-    900,  // Queen
-    20000 // King
-};
-
-// autoformat ruined both of these for me gg
-const int PAWN_TABLE[64] = {
-    0,  0,  0,  0,   0,   0,  0,  0,  50, 50, 50,  50, 50, 50,  50, 50,
-    10, 10, 20, 30,  30,  20, 10, 10, 5,  5,  10,  25, 25, 10,  5,  5,
-    0,  0,  0,  20,  20,  0,  0,  0,  5,  -5, -10, 0,  0,  -10, -5, 5,
-    5,  10, 10, -20, -20, 10, 10, 5,  0,  0,  0,   0,  0,  0,   0,  0};
-
-const int KNIGHT_TABLE[64] = {
-    -50, -40, -30, -30, -30, -30, -40, -50, -40, -20, 0,   0,   0,
-    0,   -20, -40, -30, 0,   10,  15,  15,  10,  0,   -30, -30, 5,
-    15,  20,  20,  15,  5,   -30, -30, 0,   15,  20,  20,  15,  0,
-    -30, -30, 5,   10,  15,  15,  10,  5,   -30, -40, -20, 0,   5,
-    5,   0,   -20, -40, -50, -40, -30, -30, -30, -30, -40, -50};
-
-const int INF = 99999;
-
-int Board::evaluate(Board *board) {
-  int score = 0;
-  int multiplier = board->isWhiteTurn ? 1 : -1;
+static int taper(int packed, int phase) {
+  return (mgValue(packed) * phase + egValue(packed) * (MAX_PHASE - phase)) /
+         MAX_PHASE;
+}
 
-  for (int i = 0; i < 64; ++i) {
-    char piece = board->state[i];
+// material and piece squares come out of the running total, so tracing has to
+// add them up again to keep them apart
+static void tracePieceSquares(const Board &board, EvalTrace *trace) {
+  for (int square = 0; square < 64; square++) {
+    char piece = board.state[square];
     if (piece == '0')
       continue;
 
-    ChessPiece chessPiece = charToPiece(piece);
-    bool isWhite = isupper(piece);
-    int pieceValue = PIECE_VALUES[chessPiece];
+    int side = isWhite(piece) ? 0 : 1;
+    int type = charToPiece(piece);
+    int tableSquare = side == 0 ? square ^ 56 : square;
+    trace->add(TermMaterial, side,
+               makeScore(MG_PIECE_VALUES[type], EG_PIECE_VALUES[type]));
+    trace->add(TermPieceSquares, side,
+               makeScore(MG_TABLES[type][tableSquare],
+                         EG_TABLES[type][tableSquare]));
+    trace->pieces.push_back({(int8_t)side, (int8_t)type, (int8_t)tableSquare});
+  }
+}
 
-    int positionBonus = 0;
-    switch (chessPiece) {
-    case Pawn:
-      positionBonus = isWhite ? PAWN_TABLE[i] : PAWN_TABLE[63 - i];
-      break;
-    case Knight:
-      positionBonus = isWhite ? KNIGHT_TABLE[i] : KNIGHT_TABLE[63 - i];
-      break;
-    default:
-      break;
+// the attack maps are most of the cost, so they're left for last and skipped
+// when the cheap part of the score is already far outside the window
+template <bool Trace>
+static int evaluateTerms(const Board &board, int alpha, int beta, int margin,
+                         bool &lazy, EvalTrace *trace) {
+  int multiplier = board.isWhiteTurn ? 1 : -1;
+  const MaterialEntry &material = probeMaterial(board);
+  lazy = false;
+
+  if (material.endgame != nullptr) {
+    int score = material.endgame(board, material.strongSide);
+    score = material.strongSide == 0 ? score : -score;
+    if constexpr (Trace) {
+      trace->endgame = true;
+      trace->phase = material.phase;
+      trace->scaleFactor = SCALE_NORMAL;
+      trace->score = score;
     }
+    return score * multiplier;
+  }
+
+  int packed =
+      board.psqtScore + evaluatePawns<Trace>(board, trace) + material.imbalance;
+  if constexpr (Trace) {
+    tracePieceSquares(board, trace);
+    trace->add(TermImbalance, 0, materialImbalance(board, 0));
+    trace->add(TermImbalance, 1, materialImbalance(board, 1));
+  }
 
-    int colorMultiplier = isWhite ? 1 : -1;
-    score += colorMultiplier * (pieceValue + positionBonus);
+  int cheap = taper(packed, material.phase) * multiplier;
+  if (cheap + margin <= alpha || cheap - margin >= beta) {
+    lazy = true;
+    return cheap;
   }
 
+  packed += evaluateAttacks<Trace>(board, attacksFor(board), trace);
+  int mg = mgValue(packed);
+  int eg = egValue(packed);
+  int scale = material.scaleFactor(board, eg > 0 ? 0 : 1);
+  eg = eg * scale / SCALE_NORMAL;
+
+  int score = taper(makeScore(mg, eg), material.phase);
+  if constexpr (Trace) {
+    trace->phase = material.phase;
+    trace->scaleFactor = scale;
+    trace->score = score;
+  }
   return score * multiplier;
 }
 
-int Board::negamax(Board *board, int depth, int alpha, int beta,
-                   int playerColor) {
-  std::vector<Move> legalMoves = board->GenerateLegalMoves();
+// material and piece squares are kept up to date by makeMove, the pawn terms
+// come out of the pawn hash and everything that only depends on piece counts
+// out of the material table, so this is mostly blending the middlegame and
+// endgame totals by how much material is left
+int Board::evaluate(Board *board) {
+  bool lazy;
+  return evaluate(board, -INF, INF, 0, lazy);
+}
+
+int Board::evaluate(Board *board, int alpha, int beta, int margin,
+                    bool &lazy) {
+  return evaluateTerms<false>(*board, alpha, beta, margin, lazy, nullptr);
+}
+
+int Board::evaluate(Board *board, EvalTrace &trace) {
+  bool lazy;
+  return evaluateTerms<true>(*board, -INF, INF, 0, lazy, &trace);
+}
+
+// move ordering bands: the hash move above every capture, captures above
+// every quiet move. history scores stay below the capture band
+const int TT_MOVE_SCORE = INT_MAX;
+const int CAPTURE_SCORE = 1 << 30;
+// puts a quiet move below every quiet move that isn't walking into a pawn
+const int UNSAFE_QUIET_PENALTY = 1 << 28;
+
+static bool isCapture(Board *board, const Move &move) {
+  return board->state[move.EndSquare] != '0';
+}
+
+// hash move first, then captures (most valuable victim, least valuable
+// attacker) and finally quiet moves by history score, with pieces stepping
+// onto squares enemy pawns cover last. returns false if there was no usable
+// hash move for this position
+static bool orderMoves(Board *board, std::vector<Move> &moves,
+                       const TTEntry *ttEntry, const SearchContext &context) {
+  const int side = board->isWhiteTurn ? 0 : 1;
+  const AttackInfo &attacks = attacksFor(*board);
+  uint64_t pawnCovered = attacks.attacks[1 - side][Pawn];
+  bool hasTTMove = false;
 
-  // base case: depth reached or no legal moves
-  if (depth == 0 || legalMoves.empty()) {
-    return board->evaluate(board);
+  std::vector<std::pair<int, Move>> scored;
+  scored.reserve(moves.size());
+  for (const auto &move : moves) {
+    int score;
+    if (ttEntry != nullptr && ttEntry->hasMove() && move == ttEntry->move()) {
+      score = TT_MOVE_SCORE;
+      hasTTMove = true;
+    } else if (isCapture(board, move)) {
+      score = CAPTURE_SCORE +
+              PIECE_VALUES[charToPiece(board->state[move.EndSquare])] * 10 -
+              charToPiece(board->state[move.StartSquare]);
+    } else {
+      score = context.history[side][move.StartSquare][move.EndSquare];
+      if (charToPiece(board->state[move.StartSquare]) != Pawn &&
+          ((pawnCovered >> move.EndSquare) & 1))
+        score -= UNSAFE_QUIET_PENALTY;
+    }
+    scored.push_back({score, move});
   }
 
-  int bestScore = -99999;
+  std::stable_sort(scored.begin(), scored.end(),
+                   [](const auto &a, const auto &b) { return a.first > b.first; });
+
+  for (size_t i = 0; i < moves.size(); i++)
+    moves[i] = scored[i].second;
+
+  return hasTTMove;
+}
+
+void SearchContext::startSearch(const Board &board,
+                                const std::vector<uint64_t> &history) {
+  size_t reversible = std::min(history.size(), (size_t)board.halfmoveClock);
+  keyStack.assign(history.end() - reversible, history.end());
+  rootIndex = keyStack.size();
+  keyStack.push_back(board.hash);
+
+  network = activeNetwork();
+  if (network != nullptr)
+    accumulators.reset(*network, board);
+  syzygy = activeSyzygy();
+}
+
+// mate scores are stored relative to the node instead of the root, so a mate
+// found through a transposition at a different ply keeps the right distance
+static int scoreToTT(int score, int ply) {
+  if (score >= TB_WIN_BOUND)
+    return score + ply;
+  if (score <= -TB_WIN_BOUND)
+    return score - ply;
+  return score;
+}
+
+static int scoreFromTT(int score, int ply) {
+  if (score >= TB_WIN_BOUND)
+    return score - ply;
+  if (score <= -TB_WIN_BOUND)
+    return score + ply;
+  return score;
+}
+
+// fifty move rule, dead positions and repetitions. a position that already
+// came up in the search (after the root) counts as a draw the first time it
+// repeats, one from the game before that only once it's there twice
+static bool isDraw(Board *board, const SearchContext &context) {
+  if (board->halfmoveClock >= 100 || board->hasInsufficientMaterial())
+    return true;
 
-  for (const auto &move : legalMoves) {
+  const auto &keys = context.keyStack;
+  int end = (int)keys.size();
+  int start = std::max(0, end - board->halfmoveClock);
+  int count = 0;
+
+  for (int i = end - 2; i >= start; i -= 2) {
+    if (keys[i] != board->hash)
+      continue;
+    if (i > (int)context.rootIndex || ++count >= 2)
+      return true;
+  }
+
+  return false;
+}
+
+// evaluation of the node for the side to move, from the cache when this
+// position was already evaluated. a lazy score is only good enough for this
+// window, so those don't get cached
+static int staticEval(Board *board, SearchContext &context, int alpha,
+                      int beta) {
+  int score;
+  context.stats.evalProbes++;
+  if (context.evalCache.probe(board->hash, score)) {
+    context.stats.evalHits++;
+    return score;
+  }
+
+  if (context.network != nullptr) {
+    score = context.accumulators.evaluate(*context.network, *board,
+                                          context.ply());
+  } else {
+    bool lazy;
+    score = board->evaluate(board, alpha, beta,
+                            context.params.lazyEvalMargin, lazy);
+    if (lazy) {
+      context.stats.lazyEvals++;
+      return score;
+    }
+  }
+  context.evalCache.store(board->hash, score);
+  return score;
+}
+
+NodeType childNodeType(NodeType nodeType, size_t moveIndex) {
+  switch (nodeType) {
+  case PVNode:
+    return moveIndex == 0 ? PVNode : CutNode;
+  case CutNode:
+    return AllNode;
+  default:
+    return CutNode;
+  }
+}
+
+std::vector<Move> generateRootMoves(Board &board, const SyzygyTables *syzygy) {
+  std::vector<Move> moves = board.GenerateLegalMoves();
+  if (syzygy != nullptr)
+    syzygy->filterRootMoves(board, moves);
+  return moves;
+}
+
+bool beginNode(Board *board, SearchContext &context, SearchNode &node,
+               int depth, int alpha, int beta, NodeType nodeType) {
+  // the score doesn't matter, nothing from an aborted search gets used
+  if (context.stopped()) {
+    node.score = 0;
+    return true;
+  }
+
+  if (context.network != nullptr)
+    context.accumulators.push(context.ply(), *board);
+
+  SearchStats &stats = context.stats;
+  if ((++stats.nodes & 1023) == 0)
+    publishSearchStats(context.thread, stats);
+  stats.selDepth = std::max(stats.selDepth, context.ply());
+
+  if (isDraw(board, context)) {
+    node.score = 0;
+    return true;
+  }
+
+  // endings small enough for the tables get their exact result
+  TBResult tbResult;
+  int tbPlies;
+  if (probeTablebase(*board, tbResult, tbPlies, context.waitForTables)) {
+    stats.tbHits++;
+    int mate = MATE - context.ply() - tbPlies;
+    node.score = tbResult == TBWin ? mate : tbResult == TBLoss ? -mate : 0;
+    return true;
+  }
+
+  // bigger ones from syzygy files. only right after a capture or pawn move,
+  // since the fifty move count is what the wdl result assumes
+  SyzygyWDL wdl;
+  if (context.syzygy != nullptr && board->halfmoveClock == 0 &&
+      context.syzygy->probeWDL(*board, wdl)) {
+    stats.tbHits++;
+    int win = TB_WIN - context.ply();
+    node.score = wdl == SyzygyWin ? win : wdl == SyzygyLoss ? -win : 0;
+    return true;
+  }
+
+  node.depth = depth;
+  node.alpha = alpha;
+  node.alphaOrig = alpha;
+  node.type = nodeType;
+
+  TTEntry ttEntry;
+  bool ttHit = false;
+  if (depth > 0) {
+    stats.ttProbes++;
+    ttHit = context.tt->probe(board->hash, ttEntry);
+    stats.ttHits += ttHit;
+  }
+
+  // pv nodes always get searched so the principal variation stays intact
+  if (ttHit && nodeType != PVNode && ttEntry.depth >= depth) {
+    if (ttEntry.bound == BoundExact ||
+        (ttEntry.bound == BoundLower && ttEntry.score >= beta) ||
+        (ttEntry.bound == BoundUpper && ttEntry.score <= alpha)) {
+      node.score = scoreFromTT(ttEntry.score, context.ply());
+      return true;
+    }
+  }
+
+  node.moves = board->GenerateLegalMoves();
+
+  // checkmate or stalemate
+  if (node.moves.empty()) {
+    node.score = board->isInCheck() ? -MATE + context.ply() : 0;
+    return true;
+  }
+
+  // base case: depth reached
+  if (depth == 0) {
+    stats.leafNodes++;
+    node.score = staticEval(board, context, alpha, beta);
+    return true;
+  }
+
+  bool hasTTMove =
+      orderMoves(board, node.moves, ttHit ? &ttEntry : nullptr, context);
+
+  // internal iterative reduction: without a hash move our first move is
+  // basically a guess, so nodes we expect to matter are searched a ply
+  // shallower. that still leaves a best move in the table for next time.
+  // never below one ply, or the children would skip the depth == 0 leaf
+  const SearchParams &params = context.params;
+  if (depth >= params.iirMinDepth && nodeType != AllNode && !hasTTMove)
+    node.depth = std::max(1, depth - params.iirReduction);
+
+  node.bestScore = -INF;
+  node.bestMove = node.moves[0];
+  context.keyStack.push_back(board->hash);
+  return false;
+}
+
+bool updateNode(Board *board, SearchContext &context, SearchNode &node,
+                const Move &move, int score, int beta) {
+  node.movesSearched++;
+  if (score > node.bestScore) {
+    node.bestScore = score;
+    node.bestMove = move;
+  }
+  node.alpha = std::max(node.alpha, score);
+
+  if (node.alpha < beta)
+    return false;
+
+  context.stats.betaCutoffs++;
+  if (node.movesSearched == 1)
+    context.stats.firstMoveCutoffs++;
+
+  // saturates below the capture band, history is never decayed
+  if (!isCapture(board, move)) {
+    int &history = context.history[board->isWhiteTurn ? 0 : 1]
+                                  [move.StartSquare][move.EndSquare];
+    history = std::min(history + node.depth * node.depth, CAPTURE_SCORE - 1);
+  }
+  return true;
+}
+
+int endNode(Board *board, SearchContext &context, SearchNode &node, int beta) {
+  context.keyStack.pop_back();
+
+  if (context.stopped())
+    return 0;
+
+  TTBound bound = node.bestScore >= beta           ? BoundLower
+                  : node.bestScore <= node.alphaOrig ? BoundUpper
+                                                     : BoundExact;
+  context.tt->store(board->hash, scoreToTT(node.bestScore, context.ply()),
+                    node.depth, bound,
+                    bound == BoundUpper ? Move{-1, -1} : node.bestMove);
+
+  return node.bestScore;
+}
+
+int Board::negamax(Board *board, SearchContext &context, int depth, int alpha,
+                   int beta, int playerColor, NodeType nodeType) {
+  SearchNode node;
+  if (beginNode(board, context, node, depth, alpha, beta, nodeType))
+    return node.score;
+
+  for (size_t i = 0; i < node.moves.size(); i++) {
+    const Move &move = node.moves[i];
     Board newBoard = *board;
 
     newBoard.makeMove(move);
 
     int score =
-        -newBoard.negamax(&newBoard, depth - 1, -beta, -alpha, -playerColor);
-
-    bestScore = std::max(bestScore, score);
-    alpha = std::max(alpha, score);
+        -newBoard.negamax(&newBoard, context, node.depth - 1, -beta,
+                          -node.alpha, -playerColor, childNodeType(nodeType, i));
 
-    if (alpha >= beta)
+    if (updateNode(board, context, node, move, score, beta))
       break;
   }
 
-  return bestScore;
+  return endNode(board, context, node, beta);
 }
 
-Move selectBestMove(Board *board, int depth) {
-  std::vector<Move> legalMoves = board->GenerateLegalMoves();
+// follows hash moves from the position after rootMove to rebuild the line the
+// search expects. stops at anything that isn't legal (overwritten entries)
+static std::vector<Move> extractPV(Board *board, const TranspositionTable &tt,
+                                   Move rootMove, int depth) {
+  std::vector<Move> pv = {rootMove};
+  Board current = *board;
+  current.makeMove(rootMove);
 
-  if (legalMoves.empty()) {
-    return Move{-1, -1};
+  while ((int)pv.size() < depth) {
+    TTEntry ttEntry;
+    if (!tt.probe(current.hash, ttEntry) || !ttEntry.hasMove())
+      break;
+
+    std::vector<Move> legalMoves = current.GenerateLegalMoves();
+    auto it = std::find(legalMoves.begin(), legalMoves.end(), ttEntry.move());
+    if (it == legalMoves.end())
+      break;
+
+    pv.push_back(*it);
+    current.makeMove(*it);
   }
 
-  Move bestMove = legalMoves[0];
-  int bestScore = -INF;
+  return pv;
+}
+
+// one full-width search of the root, skipping moves that earlier lines
+// already claimed
+static SearchLine searchRoot(Board *board, SearchContext &context,
+                             const std::vector<Move> &rootMoves, int depth,
+                             const std::vector<Move> &excluded) {
+  SearchLine line;
+  line.move = Move{-1, -1};
+  line.score = -INF;
+  line.depth = depth;
+
   int alpha = -INF;
   int beta = INF;
+  size_t searched = 0;
 
-  for (const auto &move : legalMoves) {
-    Board newBoard = *board;
+  for (const auto &move : rootMoves) {
+    if (std::find(excluded.begin(), excluded.end(), move) != excluded.end())
+      continue;
 
+    Board newBoard = *board;
     newBoard.makeMove(move);
 
-    int score = -newBoard.negamax(&newBoard, depth - 1, -beta, -alpha,
-                                  board->isWhiteTurn ? -1 : 1);
+    int score = -newBoard.negamax(&newBoard, context, depth - 1, -beta, -alpha,
+                                  board->isWhiteTurn ? -1 : 1,
+                                  childNodeType(PVNode, searched++));
 
-    if (score > bestScore) {
-      bestScore = score;
-      bestMove = move;
+    if (score > line.score) {
+      line.score = score;
+      line.move = move;
     }
 
     alpha = std::max(alpha, score);
   }
 
-  return bestMove;
+  return line;
+}
+
+// helper threads skip some depths so they aren't all searching the same
+// iteration at the same time. thread i (minus the main thread) skips depth d
+// when ((d + SKIP_PHASE[i]) / SKIP_SIZE[i]) is odd
+const int SKIP_SIZE[] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                         3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+const int SKIP_PHASE[] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3,
+                          4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+const int MAX_SEARCH_DEPTH = 64;
+
+// size of each thread's private table in deterministic mode
+const size_t DETERMINISTIC_TT_MB = 8;
+
+static std::atomic<int> searchThreads = 1;
+static std::atomic<bool> deterministicSearch = false;
+static std::atomic<uint64_t> lastSearchNodes = 0;
+
+void setSearchThreads(int threads) {
+  searchThreads = std::clamp(threads, 1, 256);
+}
+
+int getSearchThreads() { return searchThreads; }
+
+void setDeterministicSearch(bool deterministic) {
+  deterministicSearch = deterministic;
+}
+
+bool getDeterministicSearch() { return deterministicSearch; }
+
+uint64_t getLastSearchNodes() { return lastSearchNodes; }
+
+// marks the end of a completed iteration in the thread's stats. totalNodes is
+// what the whole search has used so far, for the branching factor
+static void recordIteration(SearchContext &context, int iteration,
+                            uint64_t totalNodes) {
+  SearchStats &stats = context.stats;
+  publishSearchStats(context.thread, stats);
+
+  stats.depth = iteration;
+  stats.iterationMs.push_back(stats.elapsedMs);
+  stats.iterationNodes.push_back(totalNodes);
+  publishSearchStats(context.thread, stats);
+}
+
+// final snapshot of every thread, then the json dump
+static void
+finishSearch(std::vector<std::unique_ptr<SearchContext>> &contexts) {
+  uint64_t nodes = 0;
+  for (auto &context : contexts) {
+    publishSearchStats(context->thread, context->stats);
+    nodes += context->stats.nodes;
+  }
+  lastSearchNodes = nodes;
+
+  dumpSearchStats();
+}
+
+// iterative deepening: each iteration leaves best moves in the transposition
+// table, which the next (deeper) iteration searches first. the lines from the
+// previous iteration are tried first at the root. returns the lines of the
+// deepest iteration that wasn't interrupted
+static std::vector<SearchLine> iterativeDeepening(Board board,
+                                                  SearchContext &context,
+                                                  int depth, int numLines,
+                                                  int threadIndex) {
+  std::vector<Move> rootMoves =
+      generateRootMoves(board, context.syzygy.get());
+  numLines = std::min(numLines, (int)rootMoves.size());
+
+  std::vector<SearchLine> lines;
+
+  for (int iteration = 1; iteration <= depth && !context.stopped();
+       iteration++) {
+    if (threadIndex > 0) {
+      int skip = (threadIndex - 1) % 20;
+      if ((iteration + SKIP_PHASE[skip]) / SKIP_SIZE[skip] % 2 != 0)
+        continue;
+    }
+
+    TTEntry ttEntry;
+    orderMoves(&board, rootMoves,
+               context.tt->probe(board.hash, ttEntry) ? &ttEntry : nullptr,
+               context);
+    for (int i = (int)lines.size() - 1; i >= 0; i--) {
+      auto it = std::find(rootMoves.begin(), rootMoves.end(), lines[i].move);
+      std::rotate(rootMoves.begin(), it, it + 1);
+    }
+
+    std::vector<SearchLine> iterationLines;
+    std::vector<Move> excluded;
+
+    for (int pvIndex = 0; pvIndex < numLines; pvIndex++) {
+      SearchLine line =
+          searchRoot(&board, context, rootMoves, iteration, excluded);
+      if (context.stopped())
+        break;
+      line.pv = extractPV(&board, *context.tt, line.move, iteration);
+
+      excluded.push_back(line.move);
+      iterationLines.push_back(line);
+    }
+
+    if (context.stopped())
+      break;
+
+    lines = iterationLines;
+    if (!lines.empty())
+      context.tt->store(board.hash, lines[0].score, iteration, BoundExact,
+                        lines[0].move);
+    recordIteration(context, iteration, context.stats.nodes);
+  }
+
+  return lines;
+}
+
+// deterministic root splitting. root moves are dealt out round robin by their
+// rank from the previous iteration and every thread searches its share with
+// its own transposition table and history, so nothing depends on timing.
+//
+// each thread keeps alpha just under the numLines-th best score it has seen,
+// which means every move that makes the overall top numLines was searched
+// with an open window and has an exact score
+static std::vector<SearchLine>
+selectBestLinesDeterministic(Board *board, int depth, int numLines,
+                             int threads, const std::atomic<bool> *stop,
+                             const std::vector<uint64_t> &history) {
+  std::shared_ptr<const SyzygyTables> syzygy = activeSyzygy();
+  std::vector<Move> rootMoves = generateRootMoves(*board, syzygy.get());
+  numLines = std::min(numLines, (int)rootMoves.size());
+  threads = std::clamp(threads, 1, std::max(1, (int)rootMoves.size()));
+
+  std::vector<std::unique_ptr<TranspositionTable>> tables;
+  std::vector<std::unique_ptr<SearchContext>> contexts;
+  for (int i = 0; i < threads; i++) {
+    tables.push_back(std::make_unique<TranspositionTable>(DETERMINISTIC_TT_MB));
+    contexts.push_back(std::make_unique<SearchContext>());
+    contexts[i]->tt = tables[i].get();
+    contexts[i]->stop = stop;
+    contexts[i]->thread = i;
+    contexts[i]->waitForTables = true;
+    contexts[i]->startSearch(*board, history);
+  }
+  beginSearchStats(threads);
+
+  orderMoves(board, rootMoves, nullptr, *contexts[0]);
+
+  std::vector<SearchLine> lines;
+
+  for (int iteration = 1; iteration <= depth; iteration++) {
+    std::vector<SearchLine> scored(rootMoves.size());
+
+    auto searchShare = [&](int thread) {
+      SearchContext &context = *contexts[thread];
+      std::vector<int> best;
+      size_t searched = 0;
+
+      for (size_t i = thread; i < rootMoves.size(); i += threads) {
+        int alpha = (int)best.size() < numLines ? -INF : best.back() - 1;
+
+        Board newBoard = *board;
+        newBoard.makeMove(rootMoves[i]);
+
+        int score = -newBoard.negamax(&newBoard, context, iteration - 1, -INF,
+                                      -alpha, board->isWhiteTurn ? -1 : 1,
+                                      childNodeType(PVNode, searched++));
+
+        scored[i].move = rootMoves[i];
+        scored[i].score = score;
+        scored[i].depth = iteration;
+
+        best.insert(std::upper_bound(best.begin(), best.end(), score,
+                                     std::greater<int>()),
+                    score);
+        if ((int)best.size() > numLines)
+          best.pop_back();
+      }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; i++)
+      workers.emplace_back(searchShare, i);
+    searchShare(0);
+    for (auto &worker : workers)
+      worker.join();
+
+    if (contexts[0]->stopped())
+      break;
+
+    // sort by score, keeping the previous order for ties
+    std::vector<size_t> ranking(scored.size());
+    for (size_t i = 0; i < ranking.size(); i++)
+      ranking[i] = i;
+    std::stable_sort(ranking.begin(), ranking.end(), [&](size_t a, size_t b) {
+      return scored[a].score > scored[b].score;
+    });
+
+    lines.clear();
+    for (size_t rank = 0; rank < ranking.size(); rank++) {
+      size_t i = ranking[rank];
+      if ((int)rank < numLines) {
+        // the pv lives in the table of the thread that searched the move
+        scored[i].pv = extractPV(board, *contexts[i % threads]->tt,
+                                 scored[i].move, iteration);
+        lines.push_back(scored[i]);
+      }
+    }
+    for (size_t rank = 0; rank < ranking.size(); rank++)
+      rootMoves[rank] = scored[ranking[rank]].move;
+
+    uint64_t totalNodes = 0;
+    for (auto &context : contexts)
+      totalNodes += context->stats.nodes;
+    recordIteration(*contexts[0], iteration, totalNodes);
+  }
+
+  finishSearch(contexts);
+
+  return lines;
+}
+
+// lazy smp. the calling thread searches to the requested depth while helpers
+// search the same position (as deep as they get) until it finishes. the
+// deepest completed result wins, ties go to the better score
+std::vector<SearchLine> selectBestLines(Board *board, int depth, int numLines,
+                                        const std::atomic<bool> *stop,
+                                        const std::vector<uint64_t> &history) {
+  int threads = searchThreads;
+  if (deterministicSearch)
+    return selectBestLinesDeterministic(board, depth, numLines, threads, stop,
+                                        history);
+
+  // the helpers stop when the main thread is done (or was stopped itself)
+  std::atomic<bool> helpersStop = false;
+  std::vector<std::vector<SearchLine>> results(threads);
+  std::vector<std::unique_ptr<SearchContext>> contexts;
+  std::vector<std::thread> helpers;
+
+  for (int i = 0; i < threads; i++) {
+    contexts.push_back(std::make_unique<SearchContext>());
+    contexts[i]->thread = i;
+    contexts[i]->startSearch(*board, history);
+  }
+  beginSearchStats(threads);
+
+  for (int i = 1; i < threads; i++) {
+    contexts[i]->stop = &helpersStop;
+    helpers.emplace_back([&, i] {
+      results[i] = iterativeDeepening(*board, *contexts[i], MAX_SEARCH_DEPTH,
+                                      numLines, i);
+    });
+  }
+
+  contexts[0]->stop = stop;
+  results[0] = iterativeDeepening(*board, *contexts[0], depth, numLines, 0);
+
+  helpersStop = true;
+  for (auto &helper : helpers)
+    helper.join();
+
+  finishSearch(contexts);
+
+  std::vector<SearchLine> *best = &results[0];
+  for (auto &result : results) {
+    if (result.empty() || best->empty())
+      continue;
+    if (result[0].depth > (*best)[0].depth ||
+        (result[0].depth == (*best)[0].depth &&
+         result[0].score > (*best)[0].score))
+      best = &result;
+  }
+
+  return *best;
+}
+
+SearchLine searchNodes(const Board &board, SearchContext &context,
+                       uint64_t maxNodes,
+                       const std::vector<uint64_t> &history) {
+  context.thread = -1;
+  context.nodeLimit = maxNodes;
+  context.waitForTables = true;
+  context.startSearch(board, history);
+
+  std::vector<SearchLine> lines =
+      iterativeDeepening(board, context, MAX_SEARCH_DEPTH, 1, 0);
+  if (!lines.empty())
+    return lines[0];
+
+  // not even the first iteration finished, any legal move will do
+  SearchLine line;
+  std::vector<Move> moves = Board(board).GenerateLegalMoves();
+  if (!moves.empty())
+    line.move = moves[0];
+  return line;
+}
+
+Move selectBestMove(Board *board, int depth, const std::atomic<bool> *stop) {
+  std::vector<SearchLine> lines = selectBestLines(board, depth, 1, stop);
+
+  if (lines.empty()) {
+    return Move{-1, -1};
+  }
+
+  return lines[0].move;
 }
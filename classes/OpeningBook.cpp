@@ -0,0 +1,149 @@
+#include "OpeningBook.h"
+#include <fstream>
+#include <iterator>
+#include <mutex>
+
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#define BOOK_USE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static std::mutex bookMutex;
+static std::shared_ptr<const OpeningBook> loadedBook;
+static bool useBook = true;
+
+std::shared_ptr<OpeningBook> OpeningBook::open(const std::string &path) {
+  std::shared_ptr<OpeningBook> book(new OpeningBook());
+  size_t size = 0;
+
+#ifdef BOOK_USE_MMAP
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return nullptr;
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+    close(fd);
+    return nullptr;
+  }
+
+  void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED)
+    return nullptr;
+
+  book->_mapping = mapping;
+  book->_mappingSize = info.st_size;
+  book->_data = (const uint8_t *)mapping;
+  size = info.st_size;
+#else
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return nullptr;
+
+  book->_buffer.assign(std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>());
+  book->_data = book->_buffer.data();
+  size = book->_buffer.size();
+#endif
+
+  if (size == 0 || size % POLYGLOT_ENTRY_SIZE != 0)
+    return nullptr;
+  book->_count = size / POLYGLOT_ENTRY_SIZE;
+  return book;
+}
+
+OpeningBook::~OpeningBook() {
+#ifdef BOOK_USE_MMAP
+  if (_mapping != nullptr)
+    munmap(_mapping, _mappingSize);
+#endif
+}
+
+std::vector<BookMove> OpeningBook::moves(const Board &board) const {
+  uint64_t key = polyglotKey(board);
+
+  // first entry with the key, the ones after it are its other moves
+  size_t low = 0;
+  size_t high = _count;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (readPolyglotEntry(_data + middle * POLYGLOT_ENTRY_SIZE).key < key)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  std::vector<BookMove> moves;
+  if (low == _count ||
+      readPolyglotEntry(_data + low * POLYGLOT_ENTRY_SIZE).key != key)
+    return moves;
+
+  std::vector<Move> legalMoves = Board(board).GenerateLegalMoves();
+  for (size_t i = low; i < _count; i++) {
+    PolyglotEntry entry = readPolyglotEntry(_data + i * POLYGLOT_ENTRY_SIZE);
+    if (entry.key != key)
+      break;
+
+    for (const Move &move : legalMoves) {
+      if (polyglotMove(board, move) == entry.move) {
+        moves.push_back({move, entry.weight});
+        break;
+      }
+    }
+  }
+  return moves;
+}
+
+bool OpeningBook::pickMove(const Board &board, uint64_t random,
+                           Move &move) const {
+  std::vector<BookMove> candidates = moves(board);
+  uint64_t total = 0;
+  for (const BookMove &candidate : candidates)
+    total += candidate.weight;
+  if (total == 0)
+    return false;
+
+  uint64_t pick = random % total;
+  for (const BookMove &candidate : candidates) {
+    if (pick < (uint64_t)candidate.weight) {
+      move = candidate.move;
+      return true;
+    }
+    pick -= candidate.weight;
+  }
+  return false;
+}
+
+bool loadBook(const std::string &path) {
+  std::shared_ptr<const OpeningBook> book = OpeningBook::open(path);
+  if (book == nullptr)
+    return false;
+
+  std::lock_guard<std::mutex> lock(bookMutex);
+  loadedBook = book;
+  return true;
+}
+
+bool bookLoaded() {
+  std::lock_guard<std::mutex> lock(bookMutex);
+  return loadedBook != nullptr;
+}
+
+void setUseBook(bool use) {
+  std::lock_guard<std::mutex> lock(bookMutex);
+  useBook = use;
+}
+
+bool getUseBook() {
+  std::lock_guard<std::mutex> lock(bookMutex);
+  return useBook && loadedBook != nullptr;
+}
+
+std::shared_ptr<const OpeningBook> activeBook() {
+  std::lock_guard<std::mutex> lock(bookMutex);
+  return useBook ? loadedBook : nullptr;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "Polyglot.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// a polyglot book (.bin) on disk. the file is mapped instead of read, and a
+// lookup is a binary search over its sorted entries, so even a big book costs
+// nothing until a position is looked up and then answers in microseconds
+
+struct BookMove {
+  Move move;
+  int weight;
+};
+
+class OpeningBook {
+public:
+  // nullptr if the file is missing, empty or not a whole number of entries
+  static std::shared_ptr<OpeningBook> open(const std::string &path);
+  ~OpeningBook();
+
+  OpeningBook(const OpeningBook &) = delete;
+  OpeningBook &operator=(const OpeningBook &) = delete;
+
+  size_t size() const { return _count; }
+
+  // the book's moves for the position that are legal here, in book order
+  std::vector<BookMove> moves(const Board &board) const;
+  // one of them at random with chances in proportion to the weights. random
+  // is any uniformly distributed 64 bit number. false if there's nothing to
+  // play (moves with weight 0 are never picked)
+  bool pickMove(const Board &board, uint64_t random, Move &move) const;
+
+private:
+  OpeningBook() = default;
+
+  const uint8_t *_data = nullptr;
+  size_t _count = 0;
+
+  // either the file is mapped or (where there's no mmap) read into _buffer
+  void *_mapping = nullptr;
+  size_t _mappingSize = 0;
+  std::vector<uint8_t> _buffer;
+};
+
+// the book the ai plays its opening moves from. false (keeping the old one) if
+// it couldn't be opened
+bool loadBook(const std::string &path);
+bool bookLoaded();
+// whether the ai plays from the loaded book, on by default
+void setUseBook(bool use);
+bool getUseBook();
+// nullptr without a book or with it turned off
+std::shared_ptr<const OpeningBook> activeBook();
@@ -0,0 +1,195 @@
+#include "PawnHash.h"
+#include "Attacks.h"
+#include "PieceSquareTables.h"
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+
+// the values live in EvalParameters.h, packed here
+static constexpr int passedPawnBonus(int relativeRank) {
+  return makeScore(MG_PASSED_PAWN[relativeRank], EG_PASSED_PAWN[relativeRank]);
+}
+
+const int DOUBLED_PAWN = makeScore(MG_DOUBLED_PAWN, EG_DOUBLED_PAWN);
+const int ISOLATED_PAWN = makeScore(MG_ISOLATED_PAWN, EG_ISOLATED_PAWN);
+const int BACKWARD_PAWN = makeScore(MG_BACKWARD_PAWN, EG_BACKWARD_PAWN);
+
+const uint64_t FILE_A = 0x0101010101010101ULL;
+
+static uint64_t fileMask(int file) { return FILE_A << file; }
+
+static uint64_t adjacentFiles(int file) {
+  return (file > 0 ? fileMask(file - 1) : 0) |
+         (file < 7 ? fileMask(file + 1) : 0);
+}
+
+// every rank in front of rank, from side's point of view
+static uint64_t forwardRanks(int side, int rank) {
+  if (side == 0)
+    return rank >= 7 ? 0 : ~0ULL << (8 * (rank + 1));
+  return rank <= 0 ? 0 : (1ULL << (8 * rank)) - 1;
+}
+
+template <bool Trace>
+static void evaluateStructure(PawnEntry &entry, EvalTrace *trace) {
+  entry.score = 0;
+
+  for (int side = 0; side < 2; side++) {
+    uint64_t own = entry.pawns[side];
+    uint64_t enemy = entry.pawns[1 - side];
+    uint64_t enemyAttacks = pawnAttacks(1 - side, enemy);
+    int sign = side == 0 ? 1 : -1;
+    int score = 0;
+
+    entry.passed[side] = 0;
+    for (uint64_t left = own; left != 0; left &= left - 1) {
+      int square = std::countr_zero(left);
+      int rank = square / 8;
+      int file = square % 8;
+      int relativeRank = side == 0 ? rank : 7 - rank;
+      uint64_t ahead = forwardRanks(side, rank);
+      uint64_t neighbours = own & adjacentFiles(file);
+
+      // the rear one of doubled pawns isn't passed, the front one is
+      bool blocked = own & ahead & fileMask(file);
+      if (!blocked &&
+          (enemy & ahead & (fileMask(file) | adjacentFiles(file))) == 0) {
+        entry.passed[side] |= 1ULL << square;
+        score += passedPawnBonus(relativeRank);
+        traceTerm<Trace>(trace, TermPassedPawns, side,
+                         passedPawnBonus(relativeRank));
+        traceCount<Trace>(trace, ParamPassedPawn + relativeRank, side);
+      }
+
+      if (blocked) {
+        score += DOUBLED_PAWN;
+        traceTerm<Trace>(trace, TermDoubledPawns, side, DOUBLED_PAWN);
+        traceCount<Trace>(trace, ParamDoubledPawn, side);
+      }
+
+      if (neighbours == 0) {
+        score += ISOLATED_PAWN;
+        traceTerm<Trace>(trace, TermIsolatedPawns, side, ISOLATED_PAWN);
+        traceCount<Trace>(trace, ParamIsolatedPawn, side);
+      } else if ((neighbours & ~ahead) == 0) {
+        // every neighbour is further up the board, so nothing can defend this
+        // pawn if it advances, and it can't advance safely if the square in
+        // front is covered by an enemy pawn
+        int stop = square + (side == 0 ? 8 : -8);
+        if (enemyAttacks & (1ULL << stop)) {
+          score += BACKWARD_PAWN;
+          traceTerm<Trace>(trace, TermBackwardPawns, side, BACKWARD_PAWN);
+          traceCount<Trace>(trace, ParamBackwardPawn, side);
+        }
+      }
+    }
+
+    entry.score += sign * score;
+  }
+}
+
+// trace, if given, gets the shield counts
+static int kingShelter(const PawnEntry &entry, int side, int kingSquare,
+                       EvalTrace *trace = nullptr) {
+  if (kingSquare < 0)
+    return 0;
+
+  int kingRank = kingSquare / 8;
+  int kingFile = kingSquare % 8;
+  uint64_t ahead = forwardRanks(side, kingRank);
+  int penalty = 0;
+
+  for (int file = std::max(0, kingFile - 1); file <= std::min(7, kingFile + 1);
+       file++) {
+    uint64_t shield = entry.pawns[side] & ahead & fileMask(file);
+    // closest one to the king
+    int distance = 4;
+    if (shield != 0) {
+      int square = side == 0 ? std::countr_zero(shield)
+                             : 63 - std::countl_zero(shield);
+      distance = std::abs(square / 8 - kingRank);
+    }
+
+    penalty += distance < 4 ? SHIELD_PENALTY[distance] : NO_SHIELD_PENALTY;
+    if (trace != nullptr)
+      trace->count(distance < 4 ? ParamShield + distance : ParamNoShield,
+                   side, 1);
+  }
+
+  // a middlegame term, in the endgame the king should come out anyway
+  return makeScore(side == 0 ? penalty : -penalty, 0);
+}
+
+static void fillEntry(PawnEntry &entry, const Board &board) {
+  uint64_t pawns[2] = {0, 0};
+  for (int i = 0; i < 64; i++) {
+    if (board.state[i] == 'P')
+      pawns[0] |= 1ULL << i;
+    else if (board.state[i] == 'p')
+      pawns[1] |= 1ULL << i;
+  }
+
+  entry = PawnEntry();
+  entry.key = board.pawnHash;
+  entry.pawns[0] = pawns[0];
+  entry.pawns[1] = pawns[1];
+}
+
+PawnHashTable::PawnHashTable(size_t entries) {
+  size_t count = 1;
+  while (count * 2 <= entries)
+    count *= 2;
+
+  _entries = std::make_unique<PawnEntry[]>(count);
+  _mask = count - 1;
+}
+
+PawnEntry &PawnHashTable::probe(const Board &board) {
+  PawnEntry &entry = _entries[board.pawnHash & _mask];
+  _probes++;
+
+  // an empty slot has key 0, the key of a board without pawns, which is fine
+  // since an empty entry is exactly what a board without pawns scores
+  if (entry.key == board.pawnHash) {
+    _hits++;
+    return entry;
+  }
+
+  fillEntry(entry, board);
+  evaluateStructure<false>(entry, nullptr);
+  return entry;
+}
+
+PawnHashTable &threadPawnTable() {
+  static thread_local PawnHashTable table;
+  return table;
+}
+
+template <bool Trace> int evaluatePawns(const Board &board, EvalTrace *trace) {
+  if constexpr (Trace) {
+    PawnEntry entry;
+    fillEntry(entry, board);
+    evaluateStructure<true>(entry, trace);
+    for (int side = 0; side < 2; side++) {
+      int shelter = kingShelter(entry, side, board.kingSquare[side], trace);
+      // kingShelter scores from white's side, the trace from each side's own
+      trace->add(TermKingShelter, side, side == 0 ? shelter : -shelter);
+      entry.score += shelter;
+    }
+    return entry.score;
+  }
+
+  PawnEntry &entry = threadPawnTable().probe(board);
+
+  for (int side = 0; side < 2; side++) {
+    if (entry.kingSquare[side] != board.kingSquare[side]) {
+      entry.kingSquare[side] = board.kingSquare[side];
+      entry.shelter[side] = kingShelter(entry, side, board.kingSquare[side]);
+    }
+  }
+
+  return entry.score + entry.shelter[0] + entry.shelter[1];
+}
+
+template int evaluatePawns<false>(const Board &board, EvalTrace *trace);
+template int evaluatePawns<true>(const Board &board, EvalTrace *trace);
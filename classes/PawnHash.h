@@ -0,0 +1,45 @@
+#pragma once
+#include "Board.h"
+#include "EvalTrace.h"
+#include <cstdint>
+#include <memory>
+
+// everything about a pawn structure that doesn't depend on the other pieces.
+// scores are packed mg/eg (see PieceSquareTables.h) from white's side
+struct PawnEntry {
+  uint64_t key = 0;
+  uint64_t pawns[2] = {};  // white, black
+  uint64_t passed[2] = {}; // passed pawns of each side
+  int score = 0;           // passed, isolated, doubled and backward pawns
+  // pawn shield in front of each king. it only depends on where the king is,
+  // so it's cached for the last king square seen with this structure
+  int kingSquare[2] = {-1, -1};
+  int shelter[2] = {};
+};
+
+// the pawn structure barely changes from one node to the next, so the pawn
+// terms are computed once per structure (keyed by Board::pawnHash) and looked
+// up after that. not shared between threads, each one gets its own table
+class PawnHashTable {
+public:
+  explicit PawnHashTable(size_t entries = 4096);
+
+  // the entry for this board's pawns, filled in if it wasn't there
+  PawnEntry &probe(const Board &board);
+
+  uint64_t probes() const { return _probes; }
+  uint64_t hits() const { return _hits; }
+
+private:
+  std::unique_ptr<PawnEntry[]> _entries;
+  size_t _mask = 0;
+  uint64_t _probes = 0;
+  uint64_t _hits = 0;
+};
+
+// pawn structure score plus both kings' pawn shields for the board, packed
+// mg/eg from white's side. uses the calling thread's table, except when
+// tracing since the entries don't keep the terms apart
+template <bool Trace = false>
+int evaluatePawns(const Board &board, EvalTrace *trace = nullptr);
+PawnHashTable &threadPawnTable();
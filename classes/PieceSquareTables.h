@@ -0,0 +1,73 @@
+#pragma once
+#include "EvalParameters.h"
+#include "Zobrist.h"
+#include <cstdint>
+
+// a middlegame and an endgame value packed into one int (eg in the high 16
+// bits) so a single add or subtract updates both
+constexpr int makeScore(int mg, int eg) {
+  return (int)((uint32_t)eg << 16) + mg;
+}
+
+constexpr int mgValue(int score) { return (int16_t)(uint16_t)(uint32_t)score; }
+
+// rounding makes up for the borrow a negative mg value takes from eg
+constexpr int egValue(int score) {
+  return (int16_t)(uint16_t)((uint32_t)(score + 0x8000) >> 16);
+}
+
+// these correlate to values from ChessPiece. only used for ordering captures
+// now, the evaluation uses the tapered values below
+inline constexpr int PIECE_VALUES[] = {
+    0,    // NoPiece
+    100,  // Pawn
+    320,  // Knight
+    330,  // Bishop
+    500,  // Rook
+    900,  // Queen
+    20000 // King
+};
+
+// game phase is 24 with all minors, rooks and queens on the board and 0 once
+// they're all gone, scores are blended between mg and eg by it
+inline constexpr int PHASE_WEIGHTS[] = {0, 0, 1, 1, 2, 4, 0};
+inline constexpr int MAX_PHASE = 24;
+
+// indexed by ChessPiece
+inline constexpr const int *MG_TABLES[] = {
+    nullptr,         MG_PAWN_TABLE,  MG_KNIGHT_TABLE, MG_BISHOP_TABLE,
+    MG_ROOK_TABLE,   MG_QUEEN_TABLE, MG_KING_TABLE};
+inline constexpr const int *EG_TABLES[] = {
+    nullptr,         EG_PAWN_TABLE,  EG_KNIGHT_TABLE, EG_BISHOP_TABLE,
+    EG_ROOK_TABLE,   EG_QUEEN_TABLE, EG_KING_TABLE};
+
+// packed material plus position for every piece (zobrist index) on every
+// square, from white's point of view, so black pieces are negative. the board
+// adds and removes these as pieces move instead of evaluate adding them up
+struct PieceSquareScores {
+  int scores[12][64];
+};
+
+constexpr PieceSquareScores generatePieceSquareScores() {
+  PieceSquareScores table{};
+
+  for (int piece = 0; piece < 12; piece++) {
+    int type = piece % 6 + 1;
+    bool white = piece < 6;
+
+    for (int square = 0; square < 64; square++) {
+      // the tables have rank 8 first, the board has rank 1 first
+      int tableSquare = white ? square ^ 56 : square;
+      int mg = MG_PIECE_VALUES[type] + MG_TABLES[type][tableSquare];
+      int eg = EG_PIECE_VALUES[type] + EG_TABLES[type][tableSquare];
+
+      table.scores[piece][square] =
+          white ? makeScore(mg, eg) : makeScore(-mg, -eg);
+    }
+  }
+
+  return table;
+}
+
+inline constexpr PieceSquareScores pieceSquareScores =
+    generatePieceSquareScores();
@@ -0,0 +1,26 @@
+#pragma once
+#include "Board.h"
+#include <cstdint>
+
+// the polyglot opening book format (.bin) that most engines and guis share. a
+// book is a list of 16 byte big endian entries sorted by position key, each a
+// move with a weight (usually how often or how well it was played)
+const int POLYGLOT_ENTRY_SIZE = 16;
+
+struct PolyglotEntry {
+  uint64_t key = 0;
+  uint16_t move = 0;
+  uint16_t weight = 0;
+  uint32_t learn = 0;
+};
+
+// polyglot's own position hash, which has nothing to do with Board::hash
+uint64_t polyglotKey(const Board &board);
+
+// to square in bits 0-5, from square in bits 6-11 and the promotion piece in
+// bits 12-14. castling is written as the king taking its own rook. the engine
+// only promotes to queens, so book underpromotions never match a move
+uint16_t polyglotMove(const Board &board, const Move &move);
+
+PolyglotEntry readPolyglotEntry(const uint8_t *data);
+void writePolyglotEntry(const PolyglotEntry &entry, uint8_t *data);
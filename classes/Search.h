@@ -0,0 +1,167 @@
+#pragma once
+#include "Board.h"
+#include "EvalCache.h"
+#include "NNUE.h"
+#include "SearchStats.h"
+#include "Syzygy.h"
+#include "TranspositionTable.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+const int INF = 99999;
+// mate scores count down from MATE by the number of plies to the mate, so
+// anything past MATE_BOUND is a forced mate
+const int MATE = 90000;
+const int MATE_BOUND = MATE - 1000;
+// syzygy wins count down the same way from TB_WIN, below every mate since the
+// tables don't say how long the mate takes
+const int TB_WIN = MATE_BOUND - 1000;
+const int TB_WIN_BOUND = TB_WIN - 1000;
+
+// search constants that can be tuned by self-play (tuner/Spsa.cpp). every
+// search reads them from its own context, so different settings can play each
+// other in one process
+struct SearchParams {
+  // internal iterative reduction kicks in from this remaining depth
+  int iirMinDepth = 4;
+  int iirReduction = 1;
+  // how far outside the window material, piece squares and pawns can be
+  // before the attack terms aren't worth computing
+  int lazyEvalMargin = 400;
+};
+
+// name, allowed range and roughly how far to perturb each of them when tuning
+struct SearchParamInfo {
+  const char *name;
+  int SearchParams::*value;
+  int min;
+  int max;
+  double step;
+};
+
+inline constexpr SearchParamInfo SEARCH_PARAMS[] = {
+    {"iirMinDepth", &SearchParams::iirMinDepth, 2, 8, 1},
+    {"iirReduction", &SearchParams::iirReduction, 1, 3, 0.6},
+    {"lazyEvalMargin", &SearchParams::lazyEvalMargin, 100, 1200, 60},
+};
+
+// one root move with its score and the line the search expects to follow it
+struct SearchLine {
+  Move move{-1, -1};
+  int score = 0;
+  int depth = 0;
+  std::vector<Move> pv;
+};
+
+// state that lives for a whole search instead of a single position. shared
+// between all the lines of a multi-pv search so later lines benefit from what
+// the earlier ones learned
+//
+// with more than one search thread every thread gets its own context, and the
+// transposition table is the only thing they share
+struct SearchContext {
+  // quiet moves that caused beta cutoffs, indexed by [side][from][to]
+  int history[2][64][64] = {};
+  SearchStats stats;
+  // which slot this thread's stats are published to
+  int thread = 0;
+  // the shared table unless this thread was given a private one
+  TranspositionTable *tt = &TT;
+  // set by the main thread once it's done to make the helpers give up
+  const std::atomic<bool> *stop = nullptr;
+  // gives up after this many nodes as well, 0 for no limit
+  uint64_t nodeLimit = 0;
+  SearchParams params;
+
+  // hashes of the positions leading up to the current node: the game since
+  // its last irreversible move, then the root, then the path searched so far
+  std::vector<uint64_t> keyStack;
+  size_t rootIndex = 0;
+
+  // set when this search evaluates with the network instead of
+  // Board::evaluate, picked once at the start so the choice can't change
+  // halfway through
+  std::shared_ptr<const Network> network;
+  AccumulatorStack accumulators;
+  EvalCache evalCache;
+  // the syzygy tables loaded when the search started, if any
+  std::shared_ptr<const SyzygyTables> syzygy;
+  // builds a missing endgame table right away instead of in the background,
+  // so the result doesn't depend on how far the builder got. deterministic
+  // mode and searchNodes need that
+  bool waitForTables = false;
+
+  bool stopped() const {
+    return (stop != nullptr && stop->load(std::memory_order_relaxed)) ||
+           (nodeLimit != 0 && stats.nodes >= nodeLimit);
+  }
+  int ply() const { return (int)(keyStack.size() - rootIndex); }
+
+  // gets the context ready to search board. history holds the hashes of the
+  // game positions before it, oldest first
+  void startSearch(const Board &board, const std::vector<uint64_t> &history);
+};
+
+// one node of the search between entering it and returning its score.
+// negamax and the cooperative search only differ in how they recurse, the
+// rest of a node goes through beginNode/updateNode/endNode
+struct SearchNode {
+  int depth = 0;
+  int alpha = 0;
+  int alphaOrig = 0;
+  NodeType type = PVNode;
+  std::vector<Move> moves;
+  int bestScore = -INF;
+  Move bestMove{-1, -1};
+  size_t movesSearched = 0;
+  // the node's result when beginNode already knows it
+  int score = 0;
+};
+
+// transposition table cutoffs, leaf evaluation, move ordering and iir. returns
+// true if the node is already resolved, with the result in node.score
+bool beginNode(Board *board, SearchContext &context, SearchNode &node,
+               int depth, int alpha, int beta, NodeType nodeType);
+// records the score of one child. returns true on a beta cutoff
+bool updateNode(Board *board, SearchContext &context, SearchNode &node,
+                const Move &move, int score, int beta);
+// stores the node in the transposition table and returns its score
+int endNode(Board *board, SearchContext &context, SearchNode &node, int beta);
+NodeType childNodeType(NodeType nodeType, size_t moveIndex);
+// the legal moves at the root, cut down to the ones that keep the best
+// syzygy result when the position is in the tables
+std::vector<Move> generateRootMoves(Board &board, const SyzygyTables *syzygy);
+
+// searches the numLines best root moves, best first. each line is searched
+// with the moves of the lines above it excluded from the root. setting stop
+// abandons the search and returns the last completed iteration (which may be
+// nothing at all). history is the game so far for repetition detection, see
+// SearchContext::startSearch
+std::vector<SearchLine> selectBestLines(Board *board, int depth, int numLines,
+                                        const std::atomic<bool> *stop = nullptr,
+                                        const std::vector<uint64_t> &history = {});
+
+// number of threads selectBestLines searches with (lazy smp). helpers search
+// the same root at staggered depths and share work through the
+// transposition table
+void setSearchThreads(int threads);
+int getSearchThreads();
+
+// opt-in reproducible mode: instead of lazy smp the root moves are split
+// between threads on a fixed schedule, each with a private table, so a
+// position, depth and thread count always give the same move and node count
+void setDeterministicSearch(bool deterministic);
+bool getDeterministicSearch();
+
+// total nodes searched by the last selectBestLines call, across all threads
+uint64_t getLastSearchNodes();
+
+// single threaded search of board with context's table and parameters that
+// gives up after maxNodes and returns the best line of the last iteration it
+// finished. leaves the global stats alone, so tools can run lots of these at
+// once (self-play). history is the game so far, as for selectBestLines
+SearchLine searchNodes(const Board &board, SearchContext &context,
+                       uint64_t maxNodes,
+                       const std::vector<uint64_t> &history = {});
@@ -0,0 +1,123 @@
+#include "SearchStats.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <mutex>
+#include <sstream>
+
+static std::mutex statsMutex;
+static std::vector<SearchStats> threadStats;
+static std::chrono::steady_clock::time_point searchStart;
+static std::string statsFile;
+
+double SearchStats::nps() const {
+  return elapsedMs > 0 ? nodes * 1000.0 / elapsedMs : 0;
+}
+
+double SearchStats::ttHitRate() const {
+  return ttProbes > 0 ? (double)ttHits / ttProbes : 0;
+}
+
+double SearchStats::evalCacheHitRate() const {
+  return evalProbes > 0 ? (double)evalHits / evalProbes : 0;
+}
+
+double SearchStats::lazyEvalRate() const {
+  uint64_t evaluations = evalProbes - evalHits;
+  return evaluations > 0 ? (double)lazyEvals / evaluations : 0;
+}
+
+double SearchStats::firstMoveCutoffRate() const {
+  return betaCutoffs > 0 ? (double)firstMoveCutoffs / betaCutoffs : 0;
+}
+
+double SearchStats::branchingFactor() const {
+  if (iterationNodes.size() < 2 || iterationNodes.front() == 0)
+    return 0;
+
+  double growth = (double)iterationNodes.back() / iterationNodes.front();
+  return std::pow(growth, 1.0 / (iterationNodes.size() - 1));
+}
+
+void SearchStats::merge(const SearchStats &other) {
+  nodes += other.nodes;
+  leafNodes += other.leafNodes;
+  ttProbes += other.ttProbes;
+  ttHits += other.ttHits;
+  evalProbes += other.evalProbes;
+  evalHits += other.evalHits;
+  lazyEvals += other.lazyEvals;
+  tbHits += other.tbHits;
+  betaCutoffs += other.betaCutoffs;
+  firstMoveCutoffs += other.firstMoveCutoffs;
+  selDepth = std::max(selDepth, other.selDepth);
+}
+
+std::string SearchStats::toJSON() const {
+  std::ostringstream json;
+  json << "{\"nodes\":" << nodes << ",\"leafNodes\":" << leafNodes
+       << ",\"nps\":" << (uint64_t)nps() << ",\"depth\":" << depth
+       << ",\"selDepth\":" << selDepth << ",\"ttHitRate\":" << ttHitRate()
+       << ",\"evalCacheHitRate\":" << evalCacheHitRate()
+       << ",\"lazyEvalRate\":" << lazyEvalRate() << ",\"tbHits\":" << tbHits
+       << ",\"firstMoveCutoffRate\":" << firstMoveCutoffRate()
+       << ",\"branchingFactor\":" << branchingFactor()
+       << ",\"elapsedMs\":" << elapsedMs << ",\"iterationMs\":[";
+  for (size_t i = 0; i < iterationMs.size(); i++)
+    json << (i ? "," : "") << iterationMs[i];
+  json << "]}";
+  return json.str();
+}
+
+void beginSearchStats(int threads) {
+  std::lock_guard<std::mutex> lock(statsMutex);
+  threadStats.assign(threads, SearchStats{});
+  searchStart = std::chrono::steady_clock::now();
+}
+
+void publishSearchStats(int thread, SearchStats &stats) {
+  // searches outside the live stats (searchNodes) keep to themselves
+  if (thread < 0)
+    return;
+
+  std::lock_guard<std::mutex> lock(statsMutex);
+  stats.elapsedMs = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - searchStart)
+                        .count();
+  if (thread < (int)threadStats.size())
+    threadStats[thread] = stats;
+}
+
+SearchStats getSearchStats() {
+  std::lock_guard<std::mutex> lock(statsMutex);
+  if (threadStats.empty())
+    return SearchStats{};
+
+  SearchStats merged = threadStats[0];
+  for (size_t i = 1; i < threadStats.size(); i++) {
+    merged.merge(threadStats[i]);
+    merged.elapsedMs = std::max(merged.elapsedMs, threadStats[i].elapsedMs);
+  }
+  return merged;
+}
+
+void dumpSearchStats() {
+  std::string json = getSearchStats().toJSON();
+
+  std::lock_guard<std::mutex> lock(statsMutex);
+  FILE *out = statsFile.empty() ? stdout : fopen(statsFile.c_str(), "a");
+  if (out == nullptr)
+    return;
+
+  fprintf(out, "%s\n", json.c_str());
+  if (out == stdout)
+    fflush(out);
+  else
+    fclose(out);
+}
+
+void setSearchStatsFile(const std::string &path) {
+  std::lock_guard<std::mutex> lock(statsMutex);
+  statsFile = path;
+}
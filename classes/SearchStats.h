@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// what a search spent its time on. every thread fills in its own copy with
+// plain counters and hands a snapshot over every so often, so the hot path
+// never touches anything shared
+struct SearchStats {
+  uint64_t nodes = 0;
+  // positions evaluated at the horizon (the search has no quiescence stage,
+  // these are its leaves)
+  uint64_t leafNodes = 0;
+  uint64_t ttProbes = 0;
+  uint64_t ttHits = 0;
+  uint64_t evalProbes = 0;
+  uint64_t evalHits = 0;
+  // evaluations that stopped before the attack terms
+  uint64_t lazyEvals = 0;
+  // positions the endgame tables answered
+  uint64_t tbHits = 0;
+  uint64_t betaCutoffs = 0;
+  uint64_t firstMoveCutoffs = 0;
+  // deepest completed iteration and deepest ply actually reached
+  int depth = 0;
+  int selDepth = 0;
+  double elapsedMs = 0;
+  // time and total nodes at the end of each completed iteration
+  std::vector<double> iterationMs;
+  std::vector<uint64_t> iterationNodes;
+
+  double nps() const;
+  double ttHitRate() const;
+  double evalCacheHitRate() const;
+  // out of the evaluations the cache didn't answer
+  double lazyEvalRate() const;
+  double firstMoveCutoffRate() const;
+  // average growth in nodes from one iteration to the next
+  double branchingFactor() const;
+
+  // adds another thread's counters. depth and the iteration timings stay the
+  // ones of this (the main) thread
+  void merge(const SearchStats &other);
+  std::string toJSON() const;
+};
+
+// resets the live stats for a new search with this many threads
+void beginSearchStats(int threads);
+// hands over a snapshot of one thread's stats
+void publishSearchStats(int thread, SearchStats &stats);
+// stats of the running (or last) search, merged over all threads
+SearchStats getSearchStats();
+// writes the merged stats of the finished search as one json line, to the
+// file set with setSearchStatsFile or to stdout
+void dumpSearchStats();
+void setSearchStatsFile(const std::string &path);
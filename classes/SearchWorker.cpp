@@ -0,0 +1,87 @@
+#include "SearchWorker.h"
+
+SearchWorker::SearchWorker() {}
+
+SearchWorker::~SearchWorker() {
+  if (!_thread.joinable())
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _quit = true;
+    _stop = true;
+  }
+  _wake.notify_one();
+  _thread.join();
+}
+
+void SearchWorker::start(const Board &board, int depth,
+                         const std::vector<uint64_t> &history) {
+  // the thread only gets created once it's needed, builds that search
+  // cooperatively never start one
+  if (!_thread.joinable())
+    _thread = std::thread(&SearchWorker::run, this);
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true; // whatever is running now is stale
+    _board = board;
+    _history = history;
+    _depth = depth;
+    _jobId++;
+    _hasJob = true;
+    _busy = true;
+    _ready = false;
+  }
+  _wake.notify_one();
+}
+
+bool SearchWorker::poll(SearchLine &line) {
+  if (!_ready.exchange(false, std::memory_order_acquire))
+    return false;
+
+  line = _result;
+  return true;
+}
+
+void SearchWorker::cancel() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _stop = true;
+  _hasJob = false;
+  _jobId++;
+  _busy = false;
+  _ready = false;
+}
+
+void SearchWorker::run() {
+  for (;;) {
+    Board board;
+    std::vector<uint64_t> history;
+    int depth;
+    uint64_t jobId;
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _wake.wait(lock, [this] { return _hasJob || _quit; });
+      if (_quit)
+        return;
+
+      board = _board;
+      history = _history;
+      depth = _depth;
+      jobId = _jobId;
+      _hasJob = false;
+      _stop = false;
+    }
+
+    std::vector<SearchLine> lines = selectBestLines(&board, depth, 1, &_stop, history);
+
+    // only publish if nobody started or cancelled a search in the meantime
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (jobId != _jobId || _stop)
+      continue;
+
+    _result = lines.empty() ? SearchLine{} : lines[0];
+    _busy = false;
+    _ready.store(true, std::memory_order_release);
+  }
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "Board.h"
+#include "Search.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// runs the ai search on its own thread so the render loop never blocks on it.
+// the ui hands it a copy of the board with start() and then calls poll() once
+// a frame until the move shows up
+class SearchWorker {
+public:
+  SearchWorker();
+  ~SearchWorker();
+
+  // searches a snapshot of board, abandoning whatever was running before.
+  // history is the game before it, for repetitions
+  void start(const Board &board, int depth,
+             const std::vector<uint64_t> &history);
+  // true (and fills in line) once the current search has finished. only
+  // reports each result once. line.move is {-1, -1} if there were no moves
+  bool poll(SearchLine &line);
+  // abandons the current search, its result is thrown away
+  void cancel();
+  bool busy() const { return _busy; }
+
+private:
+  void run();
+
+  std::thread _thread;
+  std::mutex _mutex;
+  std::condition_variable _wake;
+
+  // job, guarded by _mutex
+  Board _board;
+  std::vector<uint64_t> _history;
+  int _depth = 0;
+  uint64_t _jobId = 0;
+  bool _hasJob = false;
+  bool _quit = false;
+
+  std::atomic<bool> _stop = false;
+  std::atomic<bool> _busy = false;
+
+  // mailbox, _result is written before _ready is set and only read after
+  SearchLine _result;
+  std::atomic<bool> _ready = false;
+};
@@ -0,0 +1,1057 @@
+#include "Syzygy.h"
+#include "Attacks.h"
+#include "Zobrist.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#define SYZYGY_USE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const int SYZYGY_PIECES = 6;
+
+static const uint8_t WDL_MAGIC[4] = {0x71, 0xE8, 0x23, 0x5D};
+static const uint8_t DTZ_MAGIC[4] = {0xD7, 0x66, 0x0C, 0xA5};
+
+// per table flags in the file header
+enum FileFlag { FileSplit = 1, FileHasPawns = 2 };
+
+// per subtable flags
+enum PairsFlag {
+  PairsSideToMove = 1,
+  PairsMapped = 2,
+  PairsWinPlies = 4,
+  PairsLossPlies = 8,
+  PairsWide = 16,
+  PairsSingleValue = 128,
+};
+
+// files are little endian except for the compressed data itself
+static uint16_t readLE16(const uint8_t *p) { return p[0] | p[1] << 8; }
+
+static uint32_t readLE32(const uint8_t *p) {
+  return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint32_t readBE32(const uint8_t *p) {
+  return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+static uint64_t readBE64(const uint8_t *p) {
+  return (uint64_t)readBE32(p) << 32 | readBE32(p + 4);
+}
+
+static int sign(int value) { return (value > 0) - (value < 0); }
+
+// how far above (positive) or below the a1-h8 diagonal a square is
+static int offDiagonal(int square) { return (square >> 3) - (square & 7); }
+
+// the lookup tables the syzygy indexing scheme is built from, computed the
+// same way every prober does
+struct SyzygyEncoding {
+  // squares below the diagonal to 0-27
+  int mapB1H1H7[64] = {};
+  // the a1-d1-d4 triangle to 0-9, diagonal squares last
+  int mapA1D1D4[64] = {};
+  // the 462 ways to place two kings with the first in the triangle
+  int mapKK[10][64] = {};
+  uint64_t binomial[SYZYGY_PIECES][64] = {};
+  // pawn squares a2-h7 to 0-47, highest toward the edge and the back
+  int mapPawns[64] = {};
+  int leadPawnIdx[SYZYGY_PIECES][64] = {};
+  int leadPawnsSize[SYZYGY_PIECES][4] = {};
+
+  SyzygyEncoding() {
+    int code = 0;
+    for (int square = 0; square < 64; square++)
+      if (offDiagonal(square) < 0)
+        mapB1H1H7[square] = code++;
+
+    std::vector<int> diagonal;
+    code = 0;
+    for (int square = 0; square <= 27; square++) {
+      if (offDiagonal(square) < 0 && (square & 7) <= 3)
+        mapA1D1D4[square] = code++;
+      else if (offDiagonal(square) == 0 && (square & 7) <= 3)
+        diagonal.push_back(square);
+    }
+    for (int square : diagonal)
+      mapA1D1D4[square] = code++;
+
+    // with the first king on the diagonal the second one is never above it,
+    // and positions with both on it come last
+    std::vector<std::pair<int, int>> bothOnDiagonal;
+    code = 0;
+    for (int index = 0; index < 10; index++) {
+      for (int first = 0; first <= 27; first++) {
+        // b1 is the one square that maps to 0
+        if (mapA1D1D4[first] != index || (index == 0 && first != 1))
+          continue;
+
+        uint64_t near = pieceAttacks(King, first, 0) | 1ULL << first;
+        for (int second = 0; second < 64; second++) {
+          if ((near >> second) & 1)
+            continue;
+          if (offDiagonal(first) == 0 && offDiagonal(second) > 0)
+            continue;
+          if (offDiagonal(first) == 0 && offDiagonal(second) == 0)
+            bothOnDiagonal.emplace_back(index, second);
+          else
+            mapKK[index][second] = code++;
+        }
+      }
+    }
+    for (auto [index, second] : bothOnDiagonal)
+      mapKK[index][second] = code++;
+
+    binomial[0][0] = 1;
+    for (int n = 1; n < 64; n++)
+      for (int k = 0; k < SYZYGY_PIECES && k <= n; k++)
+        binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0) +
+                         (k < n ? binomial[k][n - 1] : 0);
+
+    // the leading pawn is the one with the highest mapPawns, every other pawn
+    // has mapPawns[lead] squares left to go on
+    int available = 47;
+    for (int leadPawns = 1; leadPawns < SYZYGY_PIECES; leadPawns++) {
+      for (int file = 0; file < 4; file++) {
+        int index = 0;
+        for (int rank = 1; rank <= 6; rank++) {
+          int square = rank * 8 + file;
+          if (leadPawns == 1) {
+            mapPawns[square] = available--;
+            mapPawns[square ^ 7] = available--;
+          }
+          leadPawnIdx[leadPawns][square] = index;
+          index += binomial[leadPawns - 1][mapPawns[square]];
+        }
+        leadPawnsSize[leadPawns][file] = index;
+      }
+    }
+  }
+};
+
+static const SyzygyEncoding &encoding() {
+  static const SyzygyEncoding tables;
+  return tables;
+}
+
+// one compressed table: a canonical huffman code over symbols that each
+// stand for a run of values (recursive pairing), cut into blocks
+struct PairsData {
+  uint8_t flags = 0;
+  size_t blockSize = 0;
+  // every span values there's a sparse index entry pointing into the blocks
+  size_t span = 0;
+  uint32_t numBlocks = 0;
+  int maxSymLen = 0;
+  // doubles as the value of single value tables
+  int minSymLen = 0;
+  // little endian uint16 per symbol length
+  const uint8_t *lowestSym = nullptr;
+  // 3 bytes per symbol, the two symbols it expands to
+  const uint8_t *btree = nullptr;
+  // little endian uint16 per block, values in it minus one
+  const uint8_t *blockLength = nullptr;
+  size_t blockLengthSize = 0;
+  // 6 bytes per entry: block and offset into it
+  const uint8_t *sparseIndex = nullptr;
+  size_t sparseIndexSize = 0;
+  const uint8_t *data = nullptr;
+  // lowest code of each length, left aligned in 64 bits
+  std::vector<uint64_t> base64;
+  // values per symbol minus one
+  std::vector<uint8_t> symlen;
+  // the piece order of the index and how it splits into groups
+  uint8_t pieces[SYZYGY_PIECES] = {};
+  uint64_t groupIdx[SYZYGY_PIECES + 1] = {};
+  int groupLen[SYZYGY_PIECES + 1] = {};
+  // where the dtz value maps of each result start
+  uint16_t mapIdx[4] = {};
+
+  int left(int symbol) const {
+    const uint8_t *entry = btree + 3 * symbol;
+    return ((entry[1] & 0xF) << 8) | entry[0];
+  }
+  int right(int symbol) const {
+    const uint8_t *entry = btree + 3 * symbol;
+    return (entry[2] << 4) | (entry[1] >> 4);
+  }
+  int length(uint32_t block) const {
+    return readLE16(blockLength + 2 * block);
+  }
+};
+
+struct SyzygyFile {
+  std::string path;
+  bool isDTZ = false;
+  std::once_flag mapOnce;
+  bool ready = false;
+#ifdef SYZYGY_USE_MMAP
+  void *mapping = nullptr;
+  size_t mappingSize = 0;
+#else
+  std::vector<uint8_t> buffer;
+#endif
+  // [side to move][file of the leading pawn]. dtz files and symmetric
+  // material only have the first side
+  PairsData pairs[2][4];
+  const uint8_t *dtzMap = nullptr;
+
+  PairsData &get(int stm, int file) { return pairs[isDTZ ? 0 : stm][file]; }
+
+  ~SyzygyFile() {
+#ifdef SYZYGY_USE_MMAP
+    if (mapping != nullptr)
+      munmap(mapping, mappingSize);
+#endif
+  }
+};
+
+struct SyzygyEntry {
+  // material with the first half of the name as white, and as black
+  uint64_t key = 0;
+  uint64_t key2 = 0;
+  int pieceCount = 0;
+  bool hasPawns = false;
+  // some side has a piece (not a king) it has no twin of
+  bool hasUniquePieces = false;
+  // pawns of the leading color (the one with fewer, if it has any) first
+  int pawnCount[2] = {};
+  SyzygyFile wdl;
+  SyzygyFile dtz;
+};
+
+// decompressed blocks, shared by every thread probing the same tables. each
+// shard is a small direct mapped table behind its own lock, so threads only
+// wait for each other when they want blocks in the same shard. blocks are
+// handed out as shared pointers so a replaced one stays valid for whoever is
+// still reading it
+class SyzygyBlockCache {
+public:
+  using Block = std::shared_ptr<const std::vector<uint16_t>>;
+
+  Block find(const PairsData *pairs, uint32_t block) {
+    auto [shard, slot] = locate(pairs, block);
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    return slot->pairs == pairs && slot->block == block ? slot->values
+                                                        : nullptr;
+  }
+
+  void store(const PairsData *pairs, uint32_t block, Block values) {
+    auto [shard, slot] = locate(pairs, block);
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    slot->pairs = pairs;
+    slot->block = block;
+    slot->values = std::move(values);
+  }
+
+private:
+  static const int SHARDS = 16;
+  static const int SLOTS = 16;
+
+  struct Slot {
+    const PairsData *pairs = nullptr;
+    uint32_t block = 0;
+    Block values;
+  };
+
+  struct Shard {
+    std::mutex mutex;
+    Slot slots[SLOTS];
+  };
+
+  std::pair<Shard *, Slot *> locate(const PairsData *pairs, uint32_t block) {
+    uint64_t hash = ((uintptr_t)pairs >> 4) * 0x9E3779B97F4A7C15ULL ^
+                    block * 0xBF58476D1CE4E5B9ULL;
+    hash ^= hash >> 29;
+    Shard *shard = &_shards[hash % SHARDS];
+    return {shard, &shard->slots[(hash / SHARDS) % SLOTS]};
+  }
+
+  Shard _shards[SHARDS];
+};
+
+// every value in block, by walking its huffman codes in order and expanding
+// each symbol into the values it stands for
+static std::vector<uint16_t> decompressBlock(const PairsData &d,
+                                             uint32_t block) {
+  size_t count = d.length(block) + 1;
+  std::vector<uint16_t> values;
+  values.reserve(count);
+  std::vector<int> stack;
+
+  const uint8_t *ptr = d.data + (uint64_t)block * d.blockSize;
+  uint64_t buffer = readBE64(ptr);
+  ptr += 8;
+  int bufferSize = 64;
+
+  while (values.size() < count) {
+    // codes of one length are consecutive, longer codes have lower values
+    int len = 0;
+    while (buffer < d.base64[len])
+      len++;
+    int symbol = (int)((buffer - d.base64[len]) >> (64 - len - d.minSymLen));
+    symbol += readLE16(d.lowestSym + 2 * len);
+
+    stack.push_back(symbol);
+    while (!stack.empty()) {
+      int top = stack.back();
+      stack.pop_back();
+      if (d.symlen[top] == 0) {
+        values.push_back(d.left(top));
+      } else {
+        stack.push_back(d.right(top));
+        stack.push_back(d.left(top));
+      }
+    }
+
+    len += d.minSymLen;
+    buffer <<= len;
+    bufferSize -= len;
+    if (bufferSize <= 32 && values.size() < count) {
+      bufferSize += 32;
+      buffer |= (uint64_t)readBE32(ptr) << (64 - bufferSize);
+      ptr += 4;
+    }
+  }
+
+  values.resize(count);
+  return values;
+}
+
+// the value at index. the sparse index gets close, the block lengths give the
+// exact block, and the block comes out of the cache or gets decompressed
+static int decompressPairs(const PairsData &d, uint64_t index,
+                           SyzygyBlockCache &cache) {
+  if (d.flags & PairsSingleValue)
+    return d.minSymLen;
+
+  const uint8_t *sparse = d.sparseIndex + 6 * (index / d.span);
+  uint32_t block = readLE32(sparse);
+  int offset = readLE16(sparse + 4);
+  offset += (int)(index % d.span) - (int)(d.span / 2);
+
+  while (offset < 0)
+    offset += d.length(--block) + 1;
+  while (offset > d.length(block))
+    offset -= d.length(block++) + 1;
+
+  SyzygyBlockCache::Block values = cache.find(&d, block);
+  if (values == nullptr) {
+    values = std::make_shared<const std::vector<uint16_t>>(
+        decompressBlock(d, block));
+    cache.store(&d, block, values);
+  }
+  return (*values)[offset];
+}
+
+static int setSymlen(PairsData &d, int symbol, std::vector<bool> &visited) {
+  visited[symbol] = true;
+  int right = d.right(symbol);
+  if (right == 0xFFF)
+    return 0;
+
+  int left = d.left(symbol);
+  if (!visited[left])
+    d.symlen[left] = setSymlen(d, left, visited);
+  if (!visited[right])
+    d.symlen[right] = setSymlen(d, right, visited);
+  return d.symlen[left] + d.symlen[right] + 1;
+}
+
+// reads the sizes and huffman tables of one subtable, returns what follows
+static const uint8_t *setSizes(PairsData &d, const uint8_t *data) {
+  d.flags = *data++;
+  if (d.flags & PairsSingleValue) {
+    d.minSymLen = *data++;
+    return data;
+  }
+
+  int groups = 0;
+  while (d.groupLen[groups] != 0)
+    groups++;
+  uint64_t size = d.groupIdx[groups];
+
+  d.blockSize = 1ULL << *data++;
+  d.span = 1ULL << *data++;
+  d.sparseIndexSize = (size + d.span - 1) / d.span;
+  int padding = *data++;
+  d.numBlocks = readLE32(data);
+  data += 4;
+  // padded so the sparse index never points past the end
+  d.blockLengthSize = d.numBlocks + padding;
+  d.maxSymLen = *data++;
+  d.minSymLen = *data++;
+  d.lowestSym = data;
+
+  d.base64.assign(d.maxSymLen - d.minSymLen + 1, 0);
+  for (int i = (int)d.base64.size() - 2; i >= 0; i--)
+    d.base64[i] = (d.base64[i + 1] + readLE16(d.lowestSym + 2 * i) -
+                   readLE16(d.lowestSym + 2 * (i + 1))) /
+                  2;
+  for (size_t i = 0; i < d.base64.size(); i++)
+    d.base64[i] <<= 64 - i - d.minSymLen;
+  data += d.base64.size() * 2;
+
+  d.symlen.assign(readLE16(data), 0);
+  data += 2;
+  d.btree = data;
+  std::vector<bool> visited(d.symlen.size());
+  for (size_t symbol = 0; symbol < d.symlen.size(); symbol++)
+    if (!visited[symbol])
+      d.symlen[symbol] = setSymlen(d, (int)symbol, visited);
+
+  return data + d.symlen.size() * 3 + (d.symlen.size() & 1);
+}
+
+// splits the pieces into the groups the index is built from and works out
+// how many index values each group covers
+static void setGroups(const SyzygyEntry &entry, PairsData &d,
+                      const int order[2], int file) {
+  const SyzygyEncoding &enc = encoding();
+  int n = 0;
+  int firstLen = entry.hasPawns ? 0 : entry.hasUniquePieces ? 3 : 2;
+  d.groupLen[n] = 1;
+  for (int i = 1; i < entry.pieceCount; i++) {
+    if (--firstLen > 0 || d.pieces[i] == d.pieces[i - 1])
+      d.groupLen[n]++;
+    else
+      d.groupLen[++n] = 1;
+  }
+  d.groupLen[++n] = 0;
+
+  bool bothPawns = entry.hasPawns && entry.pawnCount[1] != 0;
+  int next = bothPawns ? 2 : 1;
+  int freeSquares = 64 - d.groupLen[0] - (bothPawns ? d.groupLen[1] : 0);
+  uint64_t index = 1;
+
+  for (int k = 0; next < n || k == order[0] || k == order[1]; k++) {
+    if (k == order[0]) {
+      d.groupIdx[0] = index;
+      index *= entry.hasPawns          ? enc.leadPawnsSize[d.groupLen[0]][file]
+               : entry.hasUniquePieces ? 31332
+                                       : 462;
+    } else if (k == order[1]) {
+      d.groupIdx[1] = index;
+      index *= enc.binomial[d.groupLen[1]][48 - d.groupLen[0]];
+    } else {
+      d.groupIdx[next] = index;
+      index *= enc.binomial[d.groupLen[next]][freeSquares];
+      freeSquares -= d.groupLen[next++];
+    }
+  }
+  d.groupIdx[n] = index;
+}
+
+// dtz values can go through a per result map to keep the symbols small
+static const uint8_t *setDtzMap(SyzygyFile &file, const uint8_t *base,
+                                const uint8_t *data, int maxFile) {
+  file.dtzMap = data;
+  for (int f = 0; f <= maxFile; f++) {
+    PairsData &d = file.pairs[0][f];
+    if (!(d.flags & PairsMapped))
+      continue;
+
+    if (d.flags & PairsWide) {
+      data += (data - base) & 1;
+      for (int i = 0; i < 4; i++) {
+        d.mapIdx[i] = (uint16_t)((data - file.dtzMap) / 2 + 1);
+        data += 2 * readLE16(data) + 2;
+      }
+    } else {
+      for (int i = 0; i < 4; i++) {
+        d.mapIdx[i] = (uint16_t)(data - file.dtzMap + 1);
+        data += *data + 1;
+      }
+    }
+  }
+  return data + ((data - base) & 1);
+}
+
+// sets up every subtable of a mapped file. false if it doesn't look like the
+// table it's named after
+static bool parseFile(const SyzygyEntry &entry, SyzygyFile &file,
+                      const uint8_t *base, size_t size) {
+  const uint8_t *magic = file.isDTZ ? DTZ_MAGIC : WDL_MAGIC;
+  if (size < 8 || !std::equal(magic, magic + 4, base))
+    return false;
+
+  const uint8_t *data = base + 4;
+  bool split = entry.key != entry.key2;
+  if (bool(*data & FileHasPawns) != entry.hasPawns ||
+      (!file.isDTZ && bool(*data & FileSplit) != split))
+    return false;
+  data++;
+
+  int sides = !file.isDTZ && split ? 2 : 1;
+  int maxFile = entry.hasPawns ? 3 : 0;
+  bool bothPawns = entry.hasPawns && entry.pawnCount[1] != 0;
+
+  for (int f = 0; f <= maxFile; f++) {
+    int order[2][2] = {{data[0] & 0xF, bothPawns ? data[1] & 0xF : 0xF},
+                       {data[0] >> 4, bothPawns ? data[1] >> 4 : 0xF}};
+    data += 1 + bothPawns;
+
+    for (int k = 0; k < entry.pieceCount; k++, data++)
+      for (int i = 0; i < sides; i++)
+        file.pairs[i][f].pieces[k] = i ? *data >> 4 : *data & 0xF;
+
+    for (int i = 0; i < sides; i++)
+      setGroups(entry, file.pairs[i][f], order[i], f);
+  }
+
+  data += (data - base) & 1;
+  for (int f = 0; f <= maxFile; f++)
+    for (int i = 0; i < sides; i++)
+      data = setSizes(file.pairs[i][f], data);
+
+  if (file.isDTZ)
+    data = setDtzMap(file, base, data, maxFile);
+
+  for (int f = 0; f <= maxFile; f++) {
+    for (int i = 0; i < sides; i++) {
+      file.pairs[i][f].sparseIndex = data;
+      data += file.pairs[i][f].sparseIndexSize * 6;
+    }
+  }
+  for (int f = 0; f <= maxFile; f++) {
+    for (int i = 0; i < sides; i++) {
+      file.pairs[i][f].blockLength = data;
+      data += file.pairs[i][f].blockLengthSize * 2;
+    }
+  }
+  for (int f = 0; f <= maxFile; f++) {
+    for (int i = 0; i < sides; i++) {
+      data = base + (((data - base) + 0x3F) & ~(size_t)0x3F);
+      file.pairs[i][f].data = data;
+      data += (size_t)file.pairs[i][f].numBlocks * file.pairs[i][f].blockSize;
+    }
+  }
+
+  return data <= base + size;
+}
+
+static bool readFile(const SyzygyEntry &entry, SyzygyFile &file) {
+#ifdef SYZYGY_USE_MMAP
+  int fd = open(file.path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+    close(fd);
+    return false;
+  }
+
+  void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED)
+    return false;
+
+  file.mapping = mapping;
+  file.mappingSize = info.st_size;
+  return parseFile(entry, file, (const uint8_t *)mapping, info.st_size);
+#else
+  std::ifstream stream(file.path, std::ios::binary);
+  if (!stream)
+    return false;
+
+  file.buffer.assign(std::istreambuf_iterator<char>(stream),
+                     std::istreambuf_iterator<char>());
+  return parseFile(entry, file, file.buffer.data(), file.buffer.size());
+#endif
+}
+
+bool SyzygyTables::mapFile(SyzygyEntry &entry, SyzygyFile &file) const {
+  if (file.path.empty())
+    return false;
+  std::call_once(file.mapOnce, [&] { file.ready = readFile(entry, file); });
+  return file.ready;
+}
+
+// the material key Board::materialHash gives a position with white and black
+// as its pieces (like "KRP" and "KR")
+static uint64_t materialKey(const std::string &white,
+                            const std::string &black) {
+  int counts[12] = {};
+  uint64_t key = 0;
+  for (char piece : white) {
+    int index = zobristPieceIndex(piece);
+    key ^= zobrist.pieces[index][counts[index]++];
+  }
+  for (char piece : black) {
+    int index = zobristPieceIndex((char)tolower(piece));
+    key ^= zobrist.pieces[index][counts[index]++];
+  }
+  return key;
+}
+
+// sets up an entry for a file name like KRPvKR, false if it isn't one
+static bool parseName(const std::string &name, SyzygyEntry &entry) {
+  size_t split = name.find('v');
+  if (split == std::string::npos || name.size() - 1 > SYZYGY_PIECES)
+    return false;
+
+  std::string sides[2] = {name.substr(0, split), name.substr(split + 1)};
+  int pawns[2] = {};
+  for (int side = 0; side < 2; side++) {
+    const std::string &pieces = sides[side];
+    if (pieces.empty() || pieces[0] != 'K' ||
+        pieces.find_first_not_of("QRBNP", 1) != std::string::npos)
+      return false;
+
+    pawns[side] = (int)std::count(pieces.begin(), pieces.end(), 'P');
+    for (char piece : std::string("QRBNP"))
+      if (std::count(pieces.begin(), pieces.end(), piece) == 1)
+        entry.hasUniquePieces = true;
+  }
+
+  entry.key = materialKey(sides[0], sides[1]);
+  entry.key2 = materialKey(sides[1], sides[0]);
+  entry.pieceCount = (int)(name.size() - 1);
+  entry.hasPawns = pawns[0] + pawns[1] > 0;
+
+  bool whiteLeads = pawns[1] == 0 || (pawns[0] > 0 && pawns[1] >= pawns[0]);
+  entry.pawnCount[0] = whiteLeads ? pawns[0] : pawns[1];
+  entry.pawnCount[1] = whiteLeads ? pawns[1] : pawns[0];
+  return true;
+}
+
+SyzygyTables::SyzygyTables() : _cache(std::make_unique<SyzygyBlockCache>()) {}
+
+SyzygyTables::~SyzygyTables() = default;
+
+std::shared_ptr<SyzygyTables> SyzygyTables::open(const std::string &dir) {
+  namespace fs = std::filesystem;
+  std::shared_ptr<SyzygyTables> tables(new SyzygyTables());
+
+  std::error_code error;
+  for (const auto &file : fs::directory_iterator(dir, error)) {
+    const fs::path &path = file.path();
+    if (path.extension() != ".rtbw")
+      continue;
+
+    auto entry = std::make_unique<SyzygyEntry>();
+    if (!parseName(path.stem().string(), *entry) ||
+        tables->_byMaterial.count(entry->key) != 0)
+      continue;
+
+    entry->wdl.path = path.string();
+    fs::path dtzPath = fs::path(path).replace_extension(".rtbz");
+    if (fs::exists(dtzPath, error))
+      entry->dtz.path = dtzPath.string();
+    entry->dtz.isDTZ = true;
+
+    tables->_maxPieces = std::max(tables->_maxPieces, entry->pieceCount);
+    tables->_byMaterial[entry->key] = entry.get();
+    tables->_byMaterial[entry->key2] = entry.get();
+    tables->_entries.push_back(std::move(entry));
+  }
+
+  if (tables->_entries.empty())
+    return nullptr;
+  return tables;
+}
+
+bool SyzygyTables::covers(const Board &board) const {
+  int total = 0;
+  for (int count : board.pieceCounts)
+    total += count;
+  return total <= _maxPieces && !board.hasCastlingRights();
+}
+
+SyzygyEntry *SyzygyTables::find(const Board &board) const {
+  auto it = _byMaterial.find(board.materialHash);
+  return it == _byMaterial.end() ? nullptr : it->second;
+}
+
+// dtz values are stored per result, in moves or plies depending on the table
+static int mapDTZ(SyzygyFile &file, int tbFile, int value, int wdl) {
+  const int WDL_MAP[] = {1, 3, 0, 2, 0};
+  const PairsData &d = file.pairs[0][tbFile];
+  if (d.flags & PairsMapped) {
+    int index = d.mapIdx[WDL_MAP[wdl + 2]] + value;
+    value = d.flags & PairsWide ? readLE16(file.dtzMap + 2 * index)
+                                : file.dtzMap[index];
+  }
+
+  if ((wdl == SyzygyWin && !(d.flags & PairsWinPlies)) ||
+      (wdl == SyzygyLoss && !(d.flags & PairsLossPlies)) ||
+      wdl == SyzygyCursedWin || wdl == SyzygyBlessedLoss)
+    value *= 2;
+  return value + 1;
+}
+
+// the raw table value for the position: wdl from -2 to 2, or for dtz the
+// plies belonging to the already known wdl result
+int SyzygyTables::probeTable(const Board &board, bool dtz, int wdl,
+                             ProbeState &state) const {
+  int total = 0;
+  for (int count : board.pieceCounts)
+    total += count;
+  if (total == 2)
+    return SyzygyDraw;
+
+  SyzygyEntry *entry = find(board);
+  if (entry == nullptr || !mapFile(*entry, dtz ? entry->dtz : entry->wdl)) {
+    state = ProbeFail;
+    return 0;
+  }
+  SyzygyFile &file = dtz ? entry->dtz : entry->wdl;
+  const SyzygyEncoding &enc = encoding();
+  auto pawnsLess = [&](int a, int b) {
+    return enc.mapPawns[a] < enc.mapPawns[b];
+  };
+
+  // tables have white as the stronger side, and symmetric ones only white to
+  // move, so everything else gets its colors swapped
+  bool flip = (!board.isWhiteTurn && entry->key == entry->key2) ||
+              board.materialHash != entry->key;
+  int flipColor = flip ? 8 : 0;
+  int flipSquares = flip ? 56 : 0;
+  int stm = (flip ? 1 : 0) ^ (board.isWhiteTurn ? 0 : 1);
+
+  int squares[SYZYGY_PIECES];
+  int pieces[SYZYGY_PIECES];
+  int size = 0;
+  int leadPawnsCount = 0;
+  int tbFile = 0;
+  uint64_t leadPawns = 0;
+
+  // pawn tables come in four, by the file of the leading pawn
+  if (entry->hasPawns) {
+    int leadColor = (file.pairs[0][0].pieces[0] ^ flipColor) >> 3;
+    char pawn = leadColor == 0 ? 'P' : 'p';
+    for (int square = 0; square < 64; square++) {
+      if (board.state[square] == pawn) {
+        leadPawns |= 1ULL << square;
+        squares[size++] = square ^ flipSquares;
+      }
+    }
+    leadPawnsCount = size;
+    std::swap(squares[0],
+              *std::max_element(squares, squares + size, pawnsLess));
+    tbFile = std::min(squares[0] & 7, 7 - (squares[0] & 7));
+  }
+
+  // dtz tables only have one side to move
+  const PairsData &d = file.get(stm, tbFile);
+  if (dtz && (d.flags & PairsSideToMove) != stm &&
+      !(entry->key == entry->key2 && !entry->hasPawns)) {
+    state = ProbeOtherSide;
+    return 0;
+  }
+
+  for (int square = 0; square < 64; square++) {
+    char piece = board.state[square];
+    if (piece == '0' || ((leadPawns >> square) & 1))
+      continue;
+    squares[size] = square ^ flipSquares;
+    int color = isWhite(piece) ? 0 : 8;
+    pieces[size++] = (charToPiece(piece) | color) ^ flipColor;
+  }
+
+  // same order as the table lists its pieces
+  for (int i = leadPawnsCount; i < size - 1; i++) {
+    for (int j = i + 1; j < size; j++) {
+      if (d.pieces[i] == pieces[j]) {
+        std::swap(pieces[i], pieces[j]);
+        std::swap(squares[i], squares[j]);
+        break;
+      }
+    }
+  }
+
+  if ((squares[0] & 7) > 3)
+    for (int i = 0; i < size; i++)
+      squares[i] ^= 7;
+
+  uint64_t index;
+  if (entry->hasPawns) {
+    index = enc.leadPawnIdx[leadPawnsCount][squares[0]];
+    std::stable_sort(squares + 1, squares + leadPawnsCount, pawnsLess);
+    for (int i = 1; i < leadPawnsCount; i++)
+      index += enc.binomial[i][enc.mapPawns[squares[i]]];
+  } else {
+    if ((squares[0] >> 3) > 3)
+      for (int i = 0; i < size; i++)
+        squares[i] ^= 56;
+
+    // the first piece of the leading group off the diagonal goes below it
+    for (int i = 0; i < d.groupLen[0]; i++) {
+      if (offDiagonal(squares[i]) == 0)
+        continue;
+      if (offDiagonal(squares[i]) > 0)
+        for (int j = i; j < size; j++)
+          squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+      break;
+    }
+
+    if (entry->hasUniquePieces) {
+      // the first three pieces together, by where they are relative to the
+      // diagonal
+      int adjust1 = squares[1] > squares[0];
+      int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+      int rank0 = squares[0] >> 3;
+      int rank1 = squares[1] >> 3;
+      int rank2 = squares[2] >> 3;
+
+      if (offDiagonal(squares[0]) != 0)
+        index = ((uint64_t)enc.mapA1D1D4[squares[0]] * 63 +
+                 (squares[1] - adjust1)) *
+                    62 +
+                squares[2] - adjust2;
+      else if (offDiagonal(squares[1]) != 0)
+        index = (6 * 63 + rank0 * 28 + enc.mapB1H1H7[squares[1]]) * 62 +
+                squares[2] - adjust2;
+      else if (offDiagonal(squares[2]) != 0)
+        index = 6 * 63 * 62 + 4 * 28 * 62 + rank0 * 7 * 28 +
+                (rank1 - adjust1) * 28 + enc.mapB1H1H7[squares[2]];
+      else
+        index = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + rank0 * 7 * 6 +
+                (rank1 - adjust1) * 6 + (rank2 - adjust2);
+    } else {
+      index = enc.mapKK[enc.mapA1D1D4[squares[0]]][squares[1]];
+    }
+  }
+
+  // the remaining groups, each as a combination of the squares left over
+  index *= d.groupIdx[0];
+  int *groupSquares = squares + d.groupLen[0];
+  bool remainingPawns = entry->hasPawns && entry->pawnCount[1] != 0;
+  for (int next = 1; d.groupLen[next] != 0; next++) {
+    std::stable_sort(groupSquares, groupSquares + d.groupLen[next]);
+    uint64_t n = 0;
+    for (int i = 0; i < d.groupLen[next]; i++) {
+      int adjust = (int)std::count_if(squares, groupSquares, [&](int square) {
+        return groupSquares[i] > square;
+      });
+      n += enc.binomial[i + 1][groupSquares[i] - adjust - 8 * remainingPawns];
+    }
+    remainingPawns = false;
+    index += n * d.groupIdx[next];
+    groupSquares += d.groupLen[next];
+  }
+
+  int value = decompressPairs(d, index, *_cache);
+  return dtz ? mapDTZ(file, tbFile, value, wdl) : value - 2;
+}
+
+static bool isCapture(const Board &board, const Move &move) {
+  return board.state[move.EndSquare] != '0' || move.flag == EnPassant;
+}
+
+static bool isPawnMove(const Board &board, const Move &move) {
+  return charToPiece(board.state[move.StartSquare]) == Pawn;
+}
+
+// the tables don't store positions where a capture (or for dtz, any capture
+// or pawn move) is best, so those get searched first. state ends up
+// ProbeZeroingBest when one of them is what decides the result
+int SyzygyTables::searchWDL(const Board &board, bool zeroingMoves,
+                            ProbeState &state) const {
+  std::vector<Move> moves = Board(board).GenerateLegalMoves();
+  int best = SyzygyLoss;
+  size_t searched = 0;
+
+  for (const Move &move : moves) {
+    if (!isCapture(board, move) &&
+        (!zeroingMoves || !isPawnMove(board, move)))
+      continue;
+
+    searched++;
+    Board child = board;
+    child.makeMove(move);
+    int value = -searchWDL(child, false, state);
+    if (state == ProbeFail)
+      return SyzygyDraw;
+
+    if (value > best) {
+      best = value;
+      if (value >= SyzygyWin) {
+        state = ProbeZeroingBest;
+        return value;
+      }
+    }
+  }
+
+  // with every move already searched there's nothing to look up, which
+  // matters because the tables know nothing about en passant
+  bool noMoreMoves = searched > 0 && searched == moves.size();
+  int value = best;
+  if (!noMoreMoves) {
+    value = probeTable(board, false, 0, state);
+    if (state == ProbeFail)
+      return SyzygyDraw;
+  }
+
+  if (best >= value) {
+    state = best > SyzygyDraw || noMoreMoves ? ProbeZeroingBest : ProbeOK;
+    return best;
+  }
+  state = ProbeOK;
+  return value;
+}
+
+// dtz of the move before a capture or pawn move that gets result wdl
+static int dtzBeforeZeroing(int wdl) {
+  switch (wdl) {
+  case SyzygyWin:
+    return 1;
+  case SyzygyCursedWin:
+    return 101;
+  case SyzygyBlessedLoss:
+    return -101;
+  case SyzygyLoss:
+    return -1;
+  default:
+    return 0;
+  }
+}
+
+int SyzygyTables::probeDTZ(const Board &board, ProbeState &state) const {
+  state = ProbeOK;
+  int wdl = searchWDL(board, true, state);
+  if (state == ProbeFail || wdl == SyzygyDraw)
+    return 0;
+  if (state == ProbeZeroingBest)
+    return dtzBeforeZeroing(wdl);
+
+  int dtz = probeTable(board, true, wdl, state);
+  if (state == ProbeFail)
+    return 0;
+  if (state != ProbeOtherSide) {
+    bool cursed = wdl == SyzygyBlessedLoss || wdl == SyzygyCursedWin;
+    return (dtz + (cursed ? 100 : 0)) * sign(wdl);
+  }
+
+  // the table has the other side to move, so the answer is one move away
+  std::vector<Move> moves = Board(board).GenerateLegalMoves();
+  int minDTZ = 0xFFFF;
+  for (const Move &move : moves) {
+    bool zeroing = isCapture(board, move) || isPawnMove(board, move);
+    Board child = board;
+    child.makeMove(move);
+
+    ProbeState childState = ProbeOK;
+    // a zeroing move already is the end of the count, otherwise it's the
+    // child's count plus this move
+    int childDTZ =
+        zeroing ? -dtzBeforeZeroing(searchWDL(child, false, childState))
+                : -probeDTZ(child, childState);
+    if (childState == ProbeFail) {
+      state = ProbeFail;
+      return 0;
+    }
+
+    if (childDTZ == 1 && child.isInCheck() &&
+        child.GenerateLegalMoves().empty())
+      minDTZ = 1;
+    if (!zeroing)
+      childDTZ += sign(childDTZ);
+    if (childDTZ < minDTZ && sign(childDTZ) == sign(wdl))
+      minDTZ = childDTZ;
+  }
+
+  state = ProbeOK;
+  // no moves at all means mate
+  return minDTZ == 0xFFFF ? -1 : minDTZ;
+}
+
+bool SyzygyTables::probeWDL(const Board &board, SyzygyWDL &wdl) const {
+  if (!covers(board))
+    return false;
+
+  ProbeState state = ProbeOK;
+  int value = searchWDL(board, false, state);
+  if (state == ProbeFail)
+    return false;
+  wdl = (SyzygyWDL)value;
+  return true;
+}
+
+bool SyzygyTables::probeDTZ(const Board &board, int &dtz) const {
+  if (!covers(board))
+    return false;
+
+  ProbeState state = ProbeOK;
+  dtz = probeDTZ(board, state);
+  return state != ProbeFail;
+}
+
+bool SyzygyTables::filterRootMoves(const Board &board,
+                                   std::vector<Move> &moves) const {
+  if (moves.empty() || !covers(board))
+    return false;
+
+  // wins that make it inside the fifty move rule beat those that don't, and
+  // among them the quickest capture or pawn move is best. losses the other
+  // way around
+  const int MAX_DTZ = 1 << 18;
+  std::vector<int> ranks;
+  for (const Move &move : moves) {
+    Board child = board;
+    child.makeMove(move);
+
+    ProbeState state = ProbeOK;
+    int dtz;
+    if (child.halfmoveClock == 0) {
+      dtz = dtzBeforeZeroing(-searchWDL(child, false, state));
+    } else {
+      dtz = -probeDTZ(child, state);
+      dtz += sign(dtz);
+    }
+    if (state == ProbeFail)
+      return false;
+
+    if (dtz == 2 && child.isInCheck() && child.GenerateLegalMoves().empty())
+      dtz = 1;
+
+    int plies = std::abs(dtz) + board.halfmoveClock;
+    if (dtz > 0)
+      ranks.push_back(plies <= 100 ? 2 * MAX_DTZ - dtz : MAX_DTZ - dtz);
+    else if (dtz < 0)
+      ranks.push_back(plies < 100 ? -2 * MAX_DTZ - dtz : -MAX_DTZ - dtz);
+    else
+      ranks.push_back(0);
+  }
+
+  int best = *std::max_element(ranks.begin(), ranks.end());
+  std::vector<Move> kept;
+  for (size_t i = 0; i < moves.size(); i++)
+    if (ranks[i] == best)
+      kept.push_back(moves[i]);
+  moves = kept;
+  return true;
+}
+
+static std::mutex syzygyMutex;
+static std::shared_ptr<const SyzygyTables> loadedSyzygy;
+
+bool loadSyzygy(const std::string &dir) {
+  std::shared_ptr<const SyzygyTables> tables = SyzygyTables::open(dir);
+  if (tables == nullptr)
+    return false;
+
+  std::lock_guard<std::mutex> lock(syzygyMutex);
+  loadedSyzygy = tables;
+  return true;
+}
+
+bool syzygyLoaded() {
+  std::lock_guard<std::mutex> lock(syzygyMutex);
+  return loadedSyzygy != nullptr;
+}
+
+std::shared_ptr<const SyzygyTables> activeSyzygy() {
+  std::lock_guard<std::mutex> lock(syzygyMutex);
+  return loadedSyzygy;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "Board.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// probing of syzygy endgame tables (the .rtbw/.rtbz files other engines use)
+// for endings with up to six pieces, straight from a directory on disk.
+//
+// the wdl files say whether the side to move wins, draws or loses. the dtz
+// files say how many plies it takes until the next capture or pawn move on
+// the way there, which is what keeps a won ending making progress under the
+// fifty move rule
+//
+// opening a directory only lists its files. each file gets mapped the first
+// time a probe needs it, and blocks of it are decompressed into a cache that
+// every search thread shares
+
+// results of a wdl probe for the side to move. cursed wins and blessed losses
+// are wins and losses the fifty move rule turns into draws
+enum SyzygyWDL {
+  SyzygyLoss = -2,
+  SyzygyBlessedLoss = -1,
+  SyzygyDraw = 0,
+  SyzygyCursedWin = 1,
+  SyzygyWin = 2,
+};
+
+struct SyzygyEntry;
+struct SyzygyFile;
+class SyzygyBlockCache;
+
+class SyzygyTables {
+public:
+  // lists the tables in dir. nullptr if there aren't any
+  static std::shared_ptr<SyzygyTables> open(const std::string &dir);
+  ~SyzygyTables();
+
+  // most pieces (kings included) of any table with a wdl file
+  int maxPieces() const { return _maxPieces; }
+  int tableCount() const { return (int)_entries.size(); }
+
+  // false if the position has more pieces than the tables, castling rights,
+  // or its table is missing or broken
+  bool probeWDL(const Board &board, SyzygyWDL &wdl) const;
+  // plies to the next capture or pawn move with best play, positive when the
+  // side to move wins and negative when it loses (0 for draws). off by one
+  // now and then, like every syzygy dtz
+  bool probeDTZ(const Board &board, int &dtz) const;
+  // cuts moves down to the ones that keep the best result the tables allow,
+  // preferring the fastest progress when winning and the slowest when losing.
+  // leaves moves alone and returns false if the dtz tables can't tell
+  bool filterRootMoves(const Board &board, std::vector<Move> &moves) const;
+
+private:
+  SyzygyTables();
+
+  enum ProbeState { ProbeFail, ProbeOK, ProbeOtherSide, ProbeZeroingBest };
+
+  bool covers(const Board &board) const;
+  SyzygyEntry *find(const Board &board) const;
+  int probeTable(const Board &board, bool dtz, int wdl,
+                 ProbeState &state) const;
+  int searchWDL(const Board &board, bool zeroingMoves,
+                ProbeState &state) const;
+  int probeDTZ(const Board &board, ProbeState &state) const;
+  bool mapFile(SyzygyEntry &entry, SyzygyFile &file) const;
+
+  std::vector<std::unique_ptr<SyzygyEntry>> _entries;
+  // both colorings of every table's material, by Board::materialHash
+  std::unordered_map<uint64_t, SyzygyEntry *> _byMaterial;
+  int _maxPieces = 0;
+  std::unique_ptr<SyzygyBlockCache> _cache;
+};
+
+// loads the tables the searches use from now on. false if dir has none
+bool loadSyzygy(const std::string &dir);
+bool syzygyLoaded();
+// the tables new searches pick up, nullptr without any
+std::shared_ptr<const SyzygyTables> activeSyzygy();
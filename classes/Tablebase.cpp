@@ -0,0 +1,713 @@
+#include "Tablebase.h"
+#include "Attacks.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cctype>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// a piece the way the tables see it, color 0 is white
+struct TBPiece {
+  int8_t color;
+  int8_t type;
+  int8_t square;
+};
+
+// the white king first, then the black king, then the other pieces in the
+// order their table lists them (white ones first, strongest first)
+struct TBPosition {
+  TBPiece pieces[TB_MAX_PIECES];
+  int count = 0;
+  int side = 0;
+};
+
+// what a table holds for each position. the low two bits are the state, the
+// rest the plies to mate. positions nobody could win yet count as draws
+enum TBState { StateDraw = 0, StateIllegal = 1, StateWin = 2, StateLoss = 3 };
+
+static int makeValue(TBState state, int plies) { return plies << 2 | state; }
+static TBState valueState(int value) { return (TBState)(value & 3); }
+static int valuePlies(int value) { return value >> 2; }
+
+// every table is named by its pieces other than the kings, as codes 1-5 for
+// white's pawn to queen and 6-10 for black's
+const int TB_PIECE_CODES = 11;
+const int TB_TABLES = TB_PIECE_CODES * TB_PIECE_CODES;
+
+// the white king only needs to be on a quarter of the board (an eighth without
+// pawns), the rest are mirror images
+const int PAWN_KING_SQUARES = 32;
+const int TRIANGLE_KING_SQUARES = 10;
+const int TRIANGLE_SQUARES[TRIANGLE_KING_SQUARES] = {0, 1,  9,  2,  10,
+                                                     18, 3, 11, 19, 27};
+
+// the engine only ever promotes to a queen, so the tables don't either
+const int PROMOTIONS[] = {Queen};
+const int PROMOTION_COUNT = sizeof(PROMOTIONS) / sizeof(PROMOTIONS[0]);
+
+struct Table {
+  // the pieces in index order, squares unused
+  TBPosition layout;
+  bool pawns = false;
+  int kingSquares = 0;
+  size_t size = 0;
+  // bits per position, packed back to back
+  int bits = 0;
+  std::vector<uint64_t> packed;
+
+  explicit Table(const TBPosition &pieces) : layout(pieces) {
+    for (int i = 2; i < layout.count; i++)
+      pawns |= layout.pieces[i].type == Pawn;
+    kingSquares = pawns ? PAWN_KING_SQUARES : TRIANGLE_KING_SQUARES;
+    size = 2 * kingSquares;
+    for (int i = 1; i < layout.count; i++)
+      size *= 64;
+  }
+
+  int read(size_t index) const {
+    size_t bit = index * bits;
+    size_t word = bit / 64;
+    int shift = bit % 64;
+    uint64_t value = packed[word] >> shift;
+    if (shift + bits > 64)
+      value |= packed[word + 1] << (64 - shift);
+    return (int)(value & ((1ULL << bits) - 1));
+  }
+};
+
+// mirrors the square left to right, top to bottom and along the a1-h8
+// diagonal, in that order, for whichever bits are set
+static int transform(int square, int flags) {
+  if (flags & 1)
+    square ^= 7;
+  if (flags & 2)
+    square ^= 56;
+  if (flags & 4)
+    square = ((square & 7) << 3) | (square >> 3);
+  return square;
+}
+
+static size_t positionIndex(const Table &table, const TBPosition &pos) {
+  int king = pos.pieces[0].square;
+  int flags = (king & 7) > 3 ? 1 : 0;
+  if (!table.pawns) {
+    if ((king >> 3) > 3)
+      flags |= 2;
+    int square = transform(king, flags);
+    if ((square >> 3) > (square & 7))
+      flags |= 4;
+    // a king on the diagonal leaves the transposed position looking the same
+    // to it, so the first piece off the diagonal decides instead
+    for (int i = 1; i < pos.count && (square >> 3) == (square & 7); i++) {
+      square = transform(pos.pieces[i].square, flags);
+      if ((square >> 3) > (square & 7))
+        flags |= 4;
+    }
+  }
+
+  king = transform(king, flags);
+  int rank = king >> 3, file = king & 7;
+  size_t index = pos.side * table.kingSquares;
+  index += table.pawns ? rank * 4 + file : file * (file + 1) / 2 + rank;
+  for (int i = 1; i < pos.count; i++)
+    index = index * 64 + transform(pos.pieces[i].square, flags);
+  return index;
+}
+
+static TBPosition decodeIndex(const Table &table, size_t index) {
+  TBPosition pos = table.layout;
+  for (int i = pos.count - 1; i >= 1; i--) {
+    pos.pieces[i].square = index % 64;
+    index /= 64;
+  }
+  int king = index % table.kingSquares;
+  pos.pieces[0].square =
+      table.pawns ? (king / 4) * 8 + king % 4 : TRIANGLE_SQUARES[king];
+  pos.side = (int)(index / table.kingSquares);
+  return pos;
+}
+
+static uint64_t occupancy(const TBPosition &pos) {
+  uint64_t occupied = 0;
+  for (int i = 0; i < pos.count; i++)
+    occupied |= 1ULL << pos.pieces[i].square;
+  return occupied;
+}
+
+static bool attacked(const TBPosition &pos, int square, int bySide,
+                     uint64_t occupied) {
+  for (int i = 0; i < pos.count; i++) {
+    const TBPiece &piece = pos.pieces[i];
+    if (piece.color != bySide)
+      continue;
+    uint64_t attacks =
+        piece.type == Pawn
+            ? pawnAttacks(bySide, 1ULL << piece.square)
+            : pieceAttacks((ChessPiece)piece.type, piece.square, occupied);
+    if ((attacks >> square) & 1)
+      return true;
+  }
+  return false;
+}
+
+static bool inCheck(const TBPosition &pos) {
+  return attacked(pos, pos.pieces[pos.side].square, 1 - pos.side,
+                  occupancy(pos));
+}
+
+// no two pieces on a square, no pawns on the back ranks and the side that just
+// moved isn't left in check
+static bool legal(const TBPosition &pos) {
+  uint64_t occupied = 0;
+  for (int i = 0; i < pos.count; i++) {
+    int square = pos.pieces[i].square;
+    int rank = square >> 3;
+    if ((occupied >> square) & 1 ||
+        (pos.pieces[i].type == Pawn && (rank == 0 || rank == 7)))
+      return false;
+    occupied |= 1ULL << square;
+  }
+  int other = 1 - pos.side;
+  return !attacked(pos, pos.pieces[other].square, pos.side, occupied);
+}
+
+// calls visit with the position after every legal move, and whether the move
+// leaves the table (captures and promotions)
+template <typename Visit>
+static void forEachMove(const TBPosition &pos, Visit visit) {
+  uint64_t occupied = occupancy(pos);
+  uint64_t own = 0;
+  for (int i = 0; i < pos.count; i++)
+    if (pos.pieces[i].color == pos.side)
+      own |= 1ULL << pos.pieces[i].square;
+
+  for (int i = 0; i < pos.count; i++) {
+    const TBPiece &piece = pos.pieces[i];
+    if (piece.color != pos.side)
+      continue;
+
+    uint64_t targets;
+    bool promotes = false;
+    if (piece.type == Pawn) {
+      int forward = pos.side == 0 ? 8 : -8;
+      int push = piece.square + forward;
+      targets = pawnAttacks(pos.side, 1ULL << piece.square) & occupied & ~own;
+      if (!((occupied >> push) & 1)) {
+        targets |= 1ULL << push;
+        int startRank = pos.side == 0 ? 1 : 6;
+        if ((piece.square >> 3) == startRank &&
+            !((occupied >> (push + forward)) & 1))
+          targets |= 1ULL << (push + forward);
+      }
+      promotes = (push >> 3) == (pos.side == 0 ? 7 : 0);
+    } else {
+      targets =
+          pieceAttacks((ChessPiece)piece.type, piece.square, occupied) & ~own;
+    }
+
+    while (targets != 0) {
+      int target = std::countr_zero(targets);
+      targets &= targets - 1;
+
+      for (int p = 0; p < (promotes ? PROMOTION_COUNT : 1); p++) {
+        TBPosition child = pos;
+        child.side = 1 - pos.side;
+        child.pieces[i].square = target;
+        if (promotes)
+          child.pieces[i].type = PROMOTIONS[p];
+
+        bool exits = promotes;
+        for (int j = 2; j < child.count; j++) {
+          if (j != i && child.pieces[j].square == target) {
+            std::copy(child.pieces + j + 1, child.pieces + child.count,
+                      child.pieces + j);
+            child.count--;
+            exits = true;
+            break;
+          }
+        }
+
+        if (!attacked(child, child.pieces[pos.side].square, child.side,
+                      occupancy(child)))
+          visit(child, exits);
+      }
+    }
+  }
+}
+
+// calls visit with every legal position that reaches pos with a move that
+// stays in the table (so no captures or promotions to undo)
+template <typename Visit>
+static void forEachUnmove(const TBPosition &pos, Visit visit) {
+  uint64_t occupied = occupancy(pos);
+  int mover = 1 - pos.side;
+
+  for (int i = 0; i < pos.count; i++) {
+    const TBPiece &piece = pos.pieces[i];
+    if (piece.color != mover)
+      continue;
+
+    uint64_t origins = 0;
+    if (piece.type == Pawn) {
+      int back = mover == 0 ? -8 : 8;
+      int from = piece.square + back;
+      int fromRank = from >> 3;
+      if (fromRank >= 1 && fromRank <= 6 && !((occupied >> from) & 1)) {
+        origins |= 1ULL << from;
+        int doubleRank = mover == 0 ? 3 : 4;
+        if ((piece.square >> 3) == doubleRank &&
+            !((occupied >> (from + back)) & 1))
+          origins |= 1ULL << (from + back);
+      }
+    } else {
+      origins = pieceAttacks((ChessPiece)piece.type, piece.square, occupied) &
+                ~occupied;
+    }
+
+    while (origins != 0) {
+      TBPosition parent = pos;
+      parent.side = mover;
+      parent.pieces[i].square = std::countr_zero(origins);
+      origins &= origins - 1;
+      if (legal(parent))
+        visit(parent);
+    }
+  }
+}
+
+// the material a side has besides its king, strongest first
+static int sideMaterial(const TBPosition &pos, int side, int *types) {
+  int count = 0;
+  for (int i = 2; i < pos.count; i++)
+    if (pos.pieces[i].color == side)
+      types[count++] = pos.pieces[i].type;
+  std::sort(types, types + count, std::greater<int>());
+  return count;
+}
+
+// turns pos into the colors and piece order its table uses and returns the
+// table's key. the side with more (or stronger) pieces always plays white
+static int canonicalize(TBPosition &pos) {
+  int white[TB_MAX_PIECES], black[TB_MAX_PIECES];
+  int whiteCount = sideMaterial(pos, 0, white);
+  int blackCount = sideMaterial(pos, 1, black);
+  bool flip = blackCount != whiteCount
+                  ? blackCount > whiteCount
+                  : std::lexicographical_compare(white, white + whiteCount,
+                                                 black, black + blackCount);
+  if (flip) {
+    for (int i = 0; i < pos.count; i++) {
+      pos.pieces[i].color ^= 1;
+      pos.pieces[i].square ^= 56;
+    }
+    std::swap(pos.pieces[0], pos.pieces[1]);
+    pos.side ^= 1;
+  }
+
+  std::sort(pos.pieces + 2, pos.pieces + pos.count,
+            [](const TBPiece &a, const TBPiece &b) {
+              return a.color != b.color ? a.color < b.color : a.type > b.type;
+            });
+
+  int codes[2] = {0, 0};
+  for (int i = 2; i < pos.count; i++)
+    codes[i - 2] = pos.pieces[i].color * 5 + pos.pieces[i].type;
+  if (codes[0] < codes[1])
+    std::swap(codes[0], codes[1]);
+  return codes[0] * TB_PIECE_CODES + codes[1];
+}
+
+// finished tables, published once they're complete
+static std::atomic<Table *> readyTables[TB_TABLES];
+static std::atomic<bool> requestedTables[TB_TABLES];
+static std::atomic<int> readyCount{0};
+
+// value of a position from whichever finished table covers it. only used on
+// positions whose table is known to be done
+static int probeFinished(TBPosition pos) {
+  if (pos.count == 2)
+    return makeValue(StateDraw, 0);
+  const Table *table = readyTables[canonicalize(pos)].load();
+  return table->read(positionIndex(*table, pos));
+}
+
+template <typename Work> static void runParallel(int threads, Work work) {
+  std::vector<std::thread> workers;
+  for (int thread = 1; thread < threads; thread++)
+    workers.emplace_back(work, thread);
+  work(0);
+  for (auto &worker : workers)
+    worker.join();
+}
+
+// the part of count thread handles
+static std::pair<size_t, size_t> slice(size_t count, int thread, int threads) {
+  return {count * thread / threads, count * (thread + 1) / threads};
+}
+
+// a result found ahead of time for a later pass
+struct Pending {
+  uint32_t index;
+  uint16_t value;
+};
+
+// marks positions with a move out of the table that doesn't lose, they can
+// never be lost however their moves inside the table turn out
+const uint8_t NEVER_LOST = 0xFF;
+
+// sorts indices and drops repeats. mirror images share an index, so the same
+// one can turn up for two different moves
+static void makeDistinct(std::vector<uint32_t> &indices) {
+  std::sort(indices.begin(), indices.end());
+  indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+}
+
+// retrograde analysis. pass n finds every position mated or mating in n plies:
+// the ones that can move into a position lost in n - 1 are won, and the ones
+// that can move into a position won in n - 1 count it off their moves that
+// stay in the table, and are lost once none are left. captures and promotions
+// lead into smaller tables that are already done, those results get queued
+// for their pass up front. returns false if stopped partway
+static bool generate(Table &table, int threads, const std::atomic<bool> &stop) {
+  std::vector<std::atomic<uint16_t>> values(table.size);
+  // moves (distinct children) inside the table not yet known to win, or
+  // NEVER_LOST
+  std::vector<std::atomic<uint8_t>> unresolved(table.size);
+  // plies to mate through the best move out of the table, for positions
+  // whose every such move wins
+  std::vector<uint16_t> exitLoss(table.size);
+  std::vector<std::vector<Pending>> due(1);
+  std::vector<uint32_t> frontier;
+
+  std::vector<std::vector<uint32_t>> found(threads);
+  std::vector<std::vector<Pending>> later(threads);
+
+  auto resolve = [&](uint32_t index, int value, int thread) {
+    uint16_t unresolved = makeValue(StateDraw, 0);
+    if (values[index].compare_exchange_strong(unresolved, (uint16_t)value))
+      found[thread].push_back(index);
+  };
+
+  auto collect = [&]() {
+    frontier.clear();
+    for (int thread = 0; thread < threads; thread++) {
+      frontier.insert(frontier.end(), found[thread].begin(),
+                      found[thread].end());
+      found[thread].clear();
+      for (const Pending &pending : later[thread]) {
+        size_t plies = valuePlies(pending.value);
+        if (plies >= due.size())
+          due.resize(plies + 1);
+        due[plies].push_back(pending);
+      }
+      later[thread].clear();
+    }
+  };
+
+  // illegal positions, mates, and whatever captures and promotions decide
+  runParallel(threads, [&](int thread) {
+    auto [begin, end] = slice(table.size, thread, threads);
+    std::vector<uint32_t> inside;
+    for (size_t index = begin; index < end; index++) {
+      if ((index & 4095) == 0 && stop)
+        return;
+
+      // the transposed copies of positions with the king on the diagonal
+      // never get looked up, they're left as illegal
+      TBPosition pos = decodeIndex(table, index);
+      unresolved[index].store(NEVER_LOST, std::memory_order_relaxed);
+      if (!legal(pos) || positionIndex(table, pos) != index) {
+        values[index] = (uint16_t)makeValue(StateIllegal, 0);
+        continue;
+      }
+
+      bool moves = false, allWins = true;
+      int win = -1, loss = 0;
+      inside.clear();
+      forEachMove(pos, [&](const TBPosition &child, bool exits) {
+        moves = true;
+        if (!exits) {
+          inside.push_back((uint32_t)positionIndex(table, child));
+          return;
+        }
+        int value = probeFinished(child);
+        int plies = valuePlies(value) + 1;
+        if (valueState(value) == StateLoss)
+          win = win < 0 ? plies : std::min(win, plies);
+        if (valueState(value) == StateWin)
+          loss = std::max(loss, plies);
+        else
+          allWins = false;
+      });
+
+      if (!moves) {
+        if (inCheck(pos)) {
+          values[index] = (uint16_t)makeValue(StateLoss, 0);
+          found[thread].push_back(index);
+        }
+      } else if (win >= 0) {
+        later[thread].push_back(
+            {(uint32_t)index, (uint16_t)makeValue(StateWin, win)});
+      } else if (allWins) {
+        makeDistinct(inside);
+        if (inside.empty()) {
+          later[thread].push_back(
+              {(uint32_t)index, (uint16_t)makeValue(StateLoss, loss)});
+        } else {
+          unresolved[index].store((uint8_t)inside.size(),
+                                  std::memory_order_relaxed);
+          exitLoss[index] = (uint16_t)loss;
+        }
+      }
+    }
+  });
+  if (stop)
+    return false;
+  collect();
+
+  for (size_t plies = 1; !frontier.empty() || plies < due.size(); plies++) {
+    if (stop)
+      return false;
+
+    std::vector<Pending> dueNow;
+    if (plies < due.size())
+      dueNow.swap(due[plies]);
+
+    runParallel(threads, [&](int thread) {
+      auto [begin, end] = slice(frontier.size(), thread, threads);
+      std::vector<uint32_t> parents;
+      for (size_t i = begin; i < end; i++) {
+        int value = values[frontier[i]].load(std::memory_order_relaxed);
+        bool childLost = valueState(value) == StateLoss;
+        parents.clear();
+        forEachUnmove(decodeIndex(table, frontier[i]),
+                      [&](const TBPosition &parent) {
+          parents.push_back((uint32_t)positionIndex(table, parent));
+        });
+        makeDistinct(parents);
+
+        for (uint32_t index : parents) {
+          if (values[index].load(std::memory_order_relaxed) != 0)
+            continue;
+          if (childLost) {
+            resolve(index, makeValue(StateWin, (int)plies), thread);
+            continue;
+          }
+          // children win in increasing plies, so the last one to count off
+          // is the longest way to lose inside the table
+          if (unresolved[index].load(std::memory_order_relaxed) ==
+                  NEVER_LOST ||
+              unresolved[index].fetch_sub(1, std::memory_order_relaxed) != 1)
+            continue;
+          int loss = std::max((int)plies, (int)exitLoss[index]);
+          if (loss == (int)plies)
+            resolve(index, makeValue(StateLoss, loss), thread);
+          else
+            later[thread].push_back(
+                {index, (uint16_t)makeValue(StateLoss, loss)});
+        }
+      }
+
+      auto [dueBegin, dueEnd] = slice(dueNow.size(), thread, threads);
+      for (size_t i = dueBegin; i < dueEnd; i++)
+        resolve(dueNow[i].index, dueNow[i].value, thread);
+    });
+    collect();
+  }
+
+  int maxPlies = 0;
+  for (const auto &value : values)
+    maxPlies = std::max(maxPlies, valuePlies(value));
+  table.bits = 2 + std::bit_width((unsigned)maxPlies);
+  table.packed.assign(table.size * table.bits / 64 + 2, 0);
+  for (size_t index = 0; index < table.size; index++) {
+    size_t bit = index * table.bits;
+    uint64_t value = values[index];
+    table.packed[bit / 64] |= value << (bit % 64);
+    if (bit % 64 + table.bits > 64)
+      table.packed[bit / 64 + 1] |= value >> (64 - bit % 64);
+  }
+  return true;
+}
+
+// builds tables one at a time, either on request from the search in the
+// background or right away for buildTablebase. a table is only built after
+// every table its captures and promotions lead into
+class TableBuilder {
+public:
+  ~TableBuilder() {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+    }
+    _wake.notify_all();
+    if (_thread.joinable())
+      _thread.join();
+  }
+
+  void request(const TBPosition &layout, int key) {
+    if (requestedTables[key].exchange(true))
+      return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _queue.push_back(layout);
+    if (!_thread.joinable())
+      _thread = std::thread(&TableBuilder::run, this);
+    _wake.notify_one();
+  }
+
+  bool build(const TBPosition &layout, int threads) {
+    std::lock_guard<std::mutex> lock(_buildMutex);
+    return buildWithDependencies(layout, threads);
+  }
+
+private:
+  void run() {
+    // leaves half the cores to the search
+    int threads = std::max(1, (int)std::thread::hardware_concurrency() / 2);
+    while (true) {
+      TBPosition layout;
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _wake.wait(lock, [&] { return _stop || !_queue.empty(); });
+        if (_stop)
+          return;
+        layout = _queue.front();
+        _queue.pop_front();
+      }
+      build(layout, threads);
+    }
+  }
+
+  bool buildWithDependencies(TBPosition layout, int threads) {
+    int key = canonicalize(layout);
+    if (readyTables[key].load() != nullptr)
+      return true;
+
+    for (int i = 2; i < layout.count; i++) {
+      TBPosition captured = layout;
+      std::copy(captured.pieces + i + 1, captured.pieces + captured.count,
+                captured.pieces + i);
+      captured.count--;
+      if (captured.count > 2 && !buildWithDependencies(captured, threads))
+        return false;
+
+      if (layout.pieces[i].type != Pawn)
+        continue;
+      for (int promotion : PROMOTIONS) {
+        TBPosition promoted = layout;
+        promoted.pieces[i].type = promotion;
+        if (!buildWithDependencies(promoted, threads))
+          return false;
+      }
+    }
+
+    auto table = std::make_unique<Table>(layout);
+    if (!generate(*table, threads, _stop))
+      return false;
+    readyTables[key].store(table.get());
+    _tables[key] = std::move(table);
+    readyCount++;
+    return true;
+  }
+
+  std::mutex _mutex;
+  std::condition_variable _wake;
+  std::deque<TBPosition> _queue;
+  std::thread _thread;
+  std::atomic<bool> _stop = false;
+  // held while building, so tables are never built twice
+  std::mutex _buildMutex;
+  std::unique_ptr<Table> _tables[TB_TABLES];
+};
+
+static TableBuilder builder;
+
+// the board as a table position, false if it has too many pieces
+static bool toPosition(const Board &board, TBPosition &pos) {
+  int total = 0;
+  for (int count : board.pieceCounts)
+    total += count;
+  if (total > TB_MAX_PIECES)
+    return false;
+
+  pos.count = 2;
+  pos.side = board.isWhiteTurn ? 0 : 1;
+  for (int square = 0; square < 64; square++) {
+    char piece = board.state[square];
+    if (piece == '0')
+      continue;
+    int color = isupper(piece) ? 0 : 1;
+    ChessPiece type = charToPiece(piece);
+    TBPiece tbPiece = {(int8_t)color, (int8_t)type, (int8_t)square};
+    if (type == King)
+      pos.pieces[color] = tbPiece;
+    else
+      pos.pieces[pos.count++] = tbPiece;
+  }
+  return true;
+}
+
+// tables assume neither side can castle or take en passant
+static bool hasSpecialMoves(const Board &board) {
+  if (board.hasCastlingRights())
+    return true;
+  if (board.enPassantIndex >= 64)
+    return false;
+
+  int side = board.isWhiteTurn ? 0 : 1;
+  char pawn = side == 0 ? 'P' : 'p';
+  uint64_t pawns = 0;
+  for (int square = 0; square < 64; square++)
+    if (board.state[square] == pawn)
+      pawns |= 1ULL << square;
+  return (pawnAttacks(side, pawns) >> board.enPassantIndex) & 1;
+}
+
+// threads a table gets built with when someone waits for it
+static int buildThreads() {
+  return std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+bool probeTablebase(const Board &board, TBResult &result, int &plies,
+                    bool wait) {
+  TBPosition pos;
+  if (!toPosition(board, pos) || hasSpecialMoves(board))
+    return false;
+
+  int key = canonicalize(pos);
+  const Table *table = pos.count > 2 ? readyTables[key].load() : nullptr;
+  if (pos.count > 2 && table == nullptr) {
+    if (!wait) {
+      builder.request(pos, key);
+      return false;
+    }
+    if (!builder.build(pos, buildThreads()))
+      return false;
+    table = readyTables[key].load();
+  }
+
+  int value = pos.count > 2 ? table->read(positionIndex(*table, pos))
+                            : makeValue(StateDraw, 0);
+  TBState state = valueState(value);
+  result = state == StateWin ? TBWin : state == StateLoss ? TBLoss : TBDraw;
+  plies = result == TBDraw ? 0 : valuePlies(value);
+  return true;
+}
+
+bool buildTablebase(const Board &board) {
+  TBPosition pos;
+  if (!toPosition(board, pos))
+    return false;
+  if (pos.count == 2)
+    return true;
+  return builder.build(pos, buildThreads());
+}
+
+int tablebasesReady() { return readyCount; }
@@ -0,0 +1,33 @@
+#pragma once
+#include "Board.h"
+
+// endgame tables for every position with up to four pieces (kings included).
+// nothing is read from disk, each table gets worked out backwards from the
+// mates (retrograde analysis) the first time the search runs into its
+// material, on a background thread. probes for it fail until it's done
+// (unless the probe waits for it), so only the endings that actually come up
+// cost any time or memory.
+//
+// a table knows win, draw or loss for every position and how many plies the
+// winning side needs to mate. the fifty move rule isn't taken into account,
+// and neither is en passant after a double pawn push inside the table, so the
+// odd pawn ending where that capture matters can come out wrong
+const int TB_MAX_PIECES = 4;
+
+enum TBResult { TBLoss = -1, TBDraw = 0, TBWin = 1 };
+
+// result for the side to move and plies to mate (0 for a draw). false if the
+// table isn't ready yet or tables don't cover the position (too many pieces,
+// castling rights or an en passant capture). with wait a missing table is
+// built on this thread first (see buildTablebase), so only the second reason
+// is left and the answer doesn't depend on timing
+bool probeTablebase(const Board &board, TBResult &result, int &plies,
+                    bool wait = false);
+
+// builds the table for the board's material (and the ones it depends on)
+// right away on this thread instead of in the background. false if tables
+// don't cover that material
+bool buildTablebase(const Board &board);
+
+// how many tables are ready
+int tablebasesReady();
@@ -0,0 +1,79 @@
+#include "TranspositionTable.h"
+
+TranspositionTable TT;
+
+// data word layout: score (32) | depth (8) | bound (8) | from (8) | to (8)
+static uint64_t packEntry(int score, int depth, TTBound bound, int from,
+                          int to) {
+  return (uint64_t)(uint32_t)score | (uint64_t)(uint8_t)depth << 32 |
+         (uint64_t)bound << 40 | (uint64_t)(uint8_t)from << 48 |
+         (uint64_t)(uint8_t)to << 56;
+}
+
+static TTEntry unpackEntry(uint64_t key, uint64_t data) {
+  TTEntry entry;
+  entry.key = key;
+  entry.score = (int32_t)(uint32_t)data;
+  entry.depth = (int8_t)(data >> 32);
+  entry.bound = (uint8_t)(data >> 40);
+  entry.from = (uint8_t)(data >> 48);
+  entry.to = (uint8_t)(data >> 56);
+  return entry;
+}
+
+TranspositionTable::TranspositionTable(size_t megabytes) { resize(megabytes); }
+
+// table size is rounded down to a power of two so indexing is just a mask
+void TranspositionTable::resize(size_t megabytes) {
+  size_t count = 1;
+  while (count * 2 * sizeof(Slot) <= megabytes * 1024 * 1024)
+    count *= 2;
+
+  _slots = std::make_unique<Slot[]>(count);
+  _mask = count - 1;
+}
+
+void TranspositionTable::clear() {
+  for (size_t i = 0; i <= _mask; i++) {
+    _slots[i].keyXorData.store(0, std::memory_order_relaxed);
+    _slots[i].data.store(0, std::memory_order_relaxed);
+  }
+}
+
+bool TranspositionTable::probe(uint64_t key, TTEntry &entry) const {
+  const Slot &slot = _slots[key & _mask];
+  uint64_t data = slot.data.load(std::memory_order_relaxed);
+  uint64_t keyXorData = slot.keyXorData.load(std::memory_order_relaxed);
+
+  if ((keyXorData ^ data) != key)
+    return false;
+
+  entry = unpackEntry(key, data);
+  return entry.bound != BoundNone;
+}
+
+void TranspositionTable::store(uint64_t key, int score, int depth,
+                               TTBound bound, Move move) {
+  Slot &slot = _slots[key & _mask];
+  uint64_t oldData = slot.data.load(std::memory_order_relaxed);
+  bool sameKey =
+      (slot.keyXorData.load(std::memory_order_relaxed) ^ oldData) == key;
+  TTEntry old = unpackEntry(key, oldData);
+
+  // keep deeper results for the same position unless this one is exact
+  if (sameKey && old.depth > depth && bound != BoundExact)
+    return;
+
+  bool hasMove = move.StartSquare >= 0 && move.StartSquare < 64;
+
+  // an upper bound search has no best move, keep the one we already had
+  if (!hasMove && sameKey && old.hasMove()) {
+    move = old.move();
+    hasMove = true;
+  }
+
+  uint64_t data = packEntry(score, depth, bound, hasMove ? move.StartSquare : 64,
+                            hasMove ? move.EndSquare : 64);
+  slot.keyXorData.store(key ^ data, std::memory_order_relaxed);
+  slot.data.store(data, std::memory_order_relaxed);
+}
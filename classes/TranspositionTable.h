@@ -0,0 +1,54 @@
+#pragma once
+#include "Board.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+enum TTBound : uint8_t {
+  BoundNone = 0,
+  BoundUpper = 1, // score is at most this (failed low)
+  BoundLower = 2, // score is at least this (failed high)
+  BoundExact = 3,
+};
+
+struct TTEntry {
+  uint64_t key = 0;
+  int32_t score = 0;
+  int8_t depth = 0;
+  uint8_t bound = BoundNone;
+  uint8_t from = 64;
+  uint8_t to = 64;
+
+  bool hasMove() const { return from < 64; }
+  Move move() const { return Move{from, to}; }
+};
+
+// remembers the result of searching a position so that reaching it again
+// (through a different move order or on the next iteration) can reuse the
+// score, or at least search the previous best move first.
+//
+// shared by every search thread without locking. each slot is two 64 bit
+// words and the key is stored xor'd with the data, so a slot that was torn by
+// two threads writing at once just fails the key check on probe
+class TranspositionTable {
+public:
+  explicit TranspositionTable(size_t megabytes = 16);
+
+  void resize(size_t megabytes);
+  void clear();
+
+  bool probe(uint64_t key, TTEntry &entry) const;
+  void store(uint64_t key, int score, int depth, TTBound bound, Move move);
+
+private:
+  struct Slot {
+    std::atomic<uint64_t> keyXorData{0};
+    std::atomic<uint64_t> data{0};
+  };
+
+  std::unique_ptr<Slot[]> _slots;
+  size_t _mask = 0;
+};
+
+extern TranspositionTable TT;
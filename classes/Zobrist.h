@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+
+// random keys for hashing a board into a single 64 bit number. every piece on
+// every square, every castling state and every en passant square gets its own
+// key and the hash of a position is just all of them xor'd together, which
+// means makeMove can keep it up to date by xor'ing keys in and out
+struct ZobristKeys {
+  uint64_t pieces[12][64];
+  uint64_t castling[16];
+  uint64_t enPassant[64];
+  uint64_t side;
+};
+
+constexpr uint64_t splitmix64(uint64_t &seed) {
+  uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+// fixed seed so hashes stay the same between runs
+constexpr ZobristKeys generateZobristKeys() {
+  ZobristKeys keys{};
+  uint64_t seed = 1070372;
+
+  for (int piece = 0; piece < 12; piece++)
+    for (int square = 0; square < 64; square++)
+      keys.pieces[piece][square] = splitmix64(seed);
+  for (int i = 0; i < 16; i++)
+    keys.castling[i] = splitmix64(seed);
+  for (int square = 0; square < 64; square++)
+    keys.enPassant[square] = splitmix64(seed);
+  keys.side = splitmix64(seed);
+
+  return keys;
+}
+
+inline constexpr ZobristKeys zobrist = generateZobristKeys();
+
+// 0-5 for white pawn..king, 6-11 for black, -1 for an empty square
+constexpr int zobristPieceIndex(char piece) {
+  switch (piece) {
+  case 'P': return 0;
+  case 'N': return 1;
+  case 'B': return 2;
+  case 'R': return 3;
+  case 'Q': return 4;
+  case 'K': return 5;
+  case 'p': return 6;
+  case 'n': return 7;
+  case 'b': return 8;
+  case 'r': return 9;
+  case 'q': return 10;
+  case 'k': return 11;
+  default: return -1;
+  }
+}
+
+constexpr uint64_t zobristPieceKey(char piece, int square) {
+  int index = zobristPieceIndex(piece);
+  return index < 0 ? 0 : zobrist.pieces[index][square];
+}
+
+// enPassantIndex uses 64 for "no square"
+constexpr uint64_t zobristEnPassantKey(int square) {
+  return (square >= 0 && square < 64) ? zobrist.enPassant[square] : 0;
+}
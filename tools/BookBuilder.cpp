@@ -0,0 +1,770 @@
+// builds a polyglot opening book (see classes/Polyglot.h) out of pgn games.
+//
+// every game is replayed with Board::makeMove up to --max-ply, and each move
+// counts as a win, draw or loss for the side that played it. worker threads
+// parse games and count into their own hash maps, so they never wait on each
+// other. when a map outgrows its share of --memory it gets sorted and written
+// to a run file in the temp directory. at the end the runs are merged a few
+// dozen at a time until the rest fit in one last pass together with whatever
+// is left in the maps. that keeps memory and open files bounded no matter how
+// big the pgn files are, as long as the disk has room for the runs.
+//
+// a move goes into the book once it was played in at least --min-games games.
+// its weight is 2 * wins + draws, scaled down per position when that doesn't
+// fit in 16 bits, and moves that never scored anything are left out
+//
+// usage: bookbuilder <games.pgn>... [--out file] [--max-ply n]
+//                    [--min-games n] [--threads n] [--memory mb] [--temp dir]
+
+#include "../classes/Attacks.h"
+#include "../classes/Polyglot.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+const char *START_FEN =
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// games read ahead of the workers, enough to keep them busy without holding
+// much of the file in memory
+const size_t QUEUE_GAMES = 4096;
+// rough size of one hash map entry with its node and bucket
+const size_t MAP_ENTRY_BYTES = 64;
+// records read from a run file at a time while merging
+const size_t RUN_BUFFER_RECORDS = 1 << 12;
+// run files open at once while merging, well below the usual file limits
+const size_t MERGE_FAN_IN = 32;
+
+struct BookKey {
+  uint64_t key;
+  uint16_t move;
+
+  bool operator==(const BookKey &other) const {
+    return key == other.key && move == other.move;
+  }
+};
+
+struct BookKeyHash {
+  size_t operator()(const BookKey &book) const {
+    return book.key ^ (book.move * 0x9E3779B97F4A7C15ULL);
+  }
+};
+
+// for the side that played the move
+struct Counts {
+  uint32_t wins = 0;
+  uint32_t draws = 0;
+  uint32_t losses = 0;
+};
+
+// one position and move with its counts. runs are sorted by key, then move
+struct Record {
+  uint64_t key;
+  uint16_t move;
+  Counts counts;
+};
+
+using CountMap = std::unordered_map<BookKey, Counts, BookKeyHash>;
+
+static bool recordLess(const Record &a, const Record &b) {
+  return a.key != b.key ? a.key < b.key : a.move < b.move;
+}
+
+// hands games from the reading thread to the workers
+class GameQueue {
+public:
+  void push(std::string game) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _notFull.wait(lock, [&] { return _games.size() < QUEUE_GAMES; });
+    _games.push_back(std::move(game));
+    _notEmpty.notify_one();
+  }
+
+  // false once the queue is closed and empty
+  bool pop(std::string &game) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _notEmpty.wait(lock, [&] { return !_games.empty() || _closed; });
+    if (_games.empty())
+      return false;
+
+    game = std::move(_games.front());
+    _games.pop_front();
+    _notFull.notify_one();
+    return true;
+  }
+
+  void close() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _closed = true;
+    _notEmpty.notify_all();
+  }
+
+private:
+  std::mutex _mutex;
+  std::condition_variable _notEmpty;
+  std::condition_variable _notFull;
+  std::deque<std::string> _games;
+  bool _closed = false;
+};
+
+struct Worker {
+  CountMap counts;
+  uint64_t games = 0;
+  uint64_t skipped = 0;
+  std::vector<std::string> runs;
+};
+
+struct Builder {
+  int maxPly = 24;
+  int minGames = 3;
+  size_t memoryMB = 1024;
+  // entries a worker's map may hold before it spills
+  size_t mapLimit = 0;
+  std::string tempDir;
+  std::string runPrefix;
+  std::atomic<int> runCount = 0;
+  GameQueue queue;
+};
+
+static bool isOwnPiece(const Board &board, char piece) {
+  return piece != '0' && isWhite(piece) == board.isWhiteTurn;
+}
+
+static bool isLegal(Board &board, const Move &move) {
+  std::vector<Move> legalMoves = board.GenerateLegalMoves();
+  return std::find(legalMoves.begin(), legalMoves.end(), move) !=
+         legalMoves.end();
+}
+
+// the move san stands for, false if it doesn't parse or can't be played.
+// the engine only promotes to queens, so underpromotions fail as well.
+//
+// the pieces that could make the move are found from the attack tables, and
+// only when more than one fits (one of them pinned, say) does it take the
+// full legal move list to tell them apart
+static bool parseSAN(Board &board, std::string san, Move &move) {
+  while (!san.empty() && strchr("+#!?", san.back()) != nullptr)
+    san.pop_back();
+
+  int kingSquare = board.isWhiteTurn ? 4 : 60;
+  if (san == "O-O" || san == "0-0") {
+    move = Move{kingSquare, kingSquare + 2};
+    return isLegal(board, move);
+  }
+  if (san == "O-O-O" || san == "0-0-0") {
+    move = Move{kingSquare, kingSquare - 2};
+    return isLegal(board, move);
+  }
+
+  ChessPiece piece = Pawn;
+  size_t start = 0;
+  if (!san.empty() && strchr("NBRQK", san[0]) != nullptr) {
+    piece = charToPiece(san[0]);
+    start = 1;
+  }
+
+  char promotion = 0;
+  size_t equals = san.find('=');
+  if (equals != std::string::npos && equals + 1 < san.size()) {
+    promotion = san[equals + 1];
+    san.erase(equals);
+  } else if (piece == Pawn && san.size() > 2 &&
+             strchr("NBRQ", san.back()) != nullptr) {
+    promotion = san.back();
+    san.pop_back();
+  }
+  if (promotion != 0 && promotion != 'Q')
+    return false;
+
+  if (san.size() < start + 2)
+    return false;
+  int toFile = san[san.size() - 2] - 'a';
+  int toRank = san[san.size() - 1] - '1';
+  if (toFile < 0 || toFile > 7 || toRank < 0 || toRank > 7)
+    return false;
+  int to = toRank * 8 + toFile;
+
+  int fromFile = -1;
+  int fromRank = -1;
+  bool capture = false;
+  for (size_t i = start; i < san.size() - 2; i++) {
+    if (san[i] >= 'a' && san[i] <= 'h')
+      fromFile = san[i] - 'a';
+    else if (san[i] >= '1' && san[i] <= '8')
+      fromRank = san[i] - '1';
+    else if (san[i] == 'x')
+      capture = true;
+    else
+      return false;
+  }
+
+  if (isOwnPiece(board, board.state[to]))
+    return false;
+
+  const char *pieces = board.isWhiteTurn ? "?PNBRQK" : "?pnbrqk";
+  char own = pieces[piece];
+  std::vector<int> from;
+
+  if (piece == Pawn) {
+    int forward = board.isWhiteTurn ? 8 : -8;
+    if (capture) {
+      int square = to - forward + (fromFile - toFile);
+      bool target = board.state[to] != '0' || to == board.enPassantIndex;
+      if (fromFile >= 0 && std::abs(fromFile - toFile) == 1 && target &&
+          square >= 0 && square < 64 && board.state[square] == own)
+        from.push_back(square);
+    } else if (board.state[to] == '0') {
+      int one = to - forward;
+      int two = one - forward;
+      int startRank = board.isWhiteTurn ? 1 : 6;
+      if (one >= 0 && one < 64 && board.state[one] == own)
+        from.push_back(one);
+      else if (one >= 0 && one < 64 && board.state[one] == '0' &&
+               two >= 0 && two < 64 && two / 8 == startRank &&
+               board.state[two] == own)
+        from.push_back(two);
+    }
+  } else {
+    uint64_t occupied = 0;
+    for (int square = 0; square < 64; square++)
+      if (board.state[square] != '0')
+        occupied |= 1ULL << square;
+
+    uint64_t sources = pieceAttacks(piece, to, occupied);
+    for (int square = 0; square < 64; square++) {
+      if (((sources >> square) & 1) && board.state[square] == own &&
+          (fromFile < 0 || square % 8 == fromFile) &&
+          (fromRank < 0 || square / 8 == fromRank))
+        from.push_back(square);
+    }
+  }
+
+  if (from.size() > 1) {
+    std::vector<Move> legalMoves = board.GenerateLegalMoves();
+    from.erase(std::remove_if(from.begin(), from.end(),
+                              [&](int square) {
+                                Move candidate{square, to};
+                                return std::find(legalMoves.begin(),
+                                                 legalMoves.end(),
+                                                 candidate) == legalMoves.end();
+                              }),
+               from.end());
+  }
+  if (from.size() != 1)
+    return false;
+
+  move = Move{from[0], to};
+  return true;
+}
+
+// the value of a tag line like [Result "1-0"], empty if line isn't that tag
+static std::string tagValue(const std::string &line, const char *tag) {
+  std::string prefix = std::string("[") + tag + " \"";
+  if (line.compare(0, prefix.size(), prefix) != 0)
+    return "";
+  size_t end = line.find('"', prefix.size());
+  if (end == std::string::npos)
+    return "";
+  return line.substr(prefix.size(), end - prefix.size());
+}
+
+// the moves of one game's movetext, without comments, variations, nags and
+// move numbers
+static std::vector<std::string> moveTokens(const std::string &text) {
+  std::vector<std::string> tokens;
+  std::string token;
+  int variationDepth = 0;
+
+  auto finish = [&] {
+    if (!token.empty() && variationDepth == 0) {
+      if (token == "1-0" || token == "0-1" || token == "1/2-1/2" ||
+          token == "*") {
+        token.clear();
+        return;
+      }
+      // move numbers, possibly stuck to the move like 12.e4 or 12...e5.
+      // castling with zeros starts with a digit too
+      if (token.compare(0, 3, "0-0") != 0) {
+        size_t skip = token.find_first_not_of("0123456789.");
+        token = skip == std::string::npos ? "" : token.substr(skip);
+      }
+      if (!token.empty() && token[0] != '$')
+        tokens.push_back(token);
+    }
+    token.clear();
+  };
+
+  for (size_t i = 0; i < text.size(); i++) {
+    char c = text[i];
+    if (c == '{') {
+      finish();
+      size_t end = text.find('}', i);
+      i = end == std::string::npos ? text.size() : end;
+    } else if (c == ';') {
+      finish();
+      size_t end = text.find('\n', i);
+      i = end == std::string::npos ? text.size() : end;
+    } else if (c == '(') {
+      finish();
+      variationDepth++;
+    } else if (c == ')') {
+      finish();
+      variationDepth = std::max(0, variationDepth - 1);
+    } else if (isspace((unsigned char)c)) {
+      finish();
+    } else {
+      token += c;
+    }
+  }
+  finish();
+  return tokens;
+}
+
+// replays one game and counts its moves. false if it was skipped for having
+// no result, a variant or a start position that doesn't load
+static bool countGame(const std::string &game, int maxPly, CountMap &counts) {
+  std::string result;
+  std::string fen = START_FEN;
+  std::string movetext;
+
+  size_t pos = 0;
+  while (pos < game.size()) {
+    size_t end = game.find('\n', pos);
+    if (end == std::string::npos)
+      end = game.size();
+    std::string line = game.substr(pos, end - pos);
+    pos = end + 1;
+
+    if (!line.empty() && line[0] == '[') {
+      std::string value;
+      if (!(value = tagValue(line, "Result")).empty())
+        result = value;
+      else if (!(value = tagValue(line, "FEN")).empty())
+        fen = value;
+      else if (!(value = tagValue(line, "Variant")).empty() &&
+               value != "Standard")
+        return false;
+    } else {
+      movetext += line;
+      movetext += '\n';
+    }
+  }
+
+  // white's score in half points
+  int whiteScore;
+  if (result == "1-0")
+    whiteScore = 2;
+  else if (result == "1/2-1/2")
+    whiteScore = 1;
+  else if (result == "0-1")
+    whiteScore = 0;
+  else
+    return false;
+
+  Board board;
+  if (!board.loadFEN(fen))
+    return false;
+
+  std::vector<std::string> tokens = moveTokens(movetext);
+  int plies = std::min((int)tokens.size(), maxPly);
+  for (int ply = 0; ply < plies; ply++) {
+    Move move;
+    // the rest of a game with a move we can't follow is lost, the part
+    // before it still counts
+    if (!parseSAN(board, tokens[ply], move))
+      break;
+
+    int score = board.isWhiteTurn ? whiteScore : 2 - whiteScore;
+    Counts &moveCounts =
+        counts[BookKey{polyglotKey(board), polyglotMove(board, move)}];
+    if (score == 2)
+      moveCounts.wins++;
+    else if (score == 1)
+      moveCounts.draws++;
+    else
+      moveCounts.losses++;
+
+    board.makeMove(move);
+  }
+  return true;
+}
+
+// empties counts into a sorted list
+static std::vector<Record> takeRecords(CountMap &counts) {
+  std::vector<Record> records;
+  records.reserve(counts.size());
+  for (const auto &[book, moveCounts] : counts)
+    records.push_back(Record{book.key, book.move, moveCounts});
+  CountMap().swap(counts);
+
+  std::sort(records.begin(), records.end(), recordLess);
+  return records;
+}
+
+// a fresh run file name in the temp directory
+static std::string runPath(Builder &builder) {
+  return (std::filesystem::path(builder.tempDir) /
+          (builder.runPrefix + std::to_string(builder.runCount++) + ".run"))
+      .string();
+}
+
+static bool spillRun(Builder &builder, Worker &worker) {
+  std::vector<Record> records = takeRecords(worker.counts);
+  std::string path = runPath(builder);
+
+  FILE *file = fopen(path.c_str(), "wb");
+  if (file == nullptr)
+    return false;
+  bool written = fwrite(records.data(), sizeof(Record), records.size(),
+                        file) == records.size();
+  written = fclose(file) == 0 && written;
+
+  worker.runs.push_back(path);
+  return written;
+}
+
+static void work(Builder &builder, Worker &worker) {
+  std::string game;
+  while (builder.queue.pop(game)) {
+    if (countGame(game, builder.maxPly, worker.counts))
+      worker.games++;
+    else
+      worker.skipped++;
+
+    if (worker.counts.size() > builder.mapLimit &&
+        !spillRun(builder, worker)) {
+      fprintf(stderr, "couldn't write a run to %s\n",
+              builder.tempDir.c_str());
+      exit(1);
+    }
+  }
+}
+
+// splits a pgn file into games for the workers. a game ends where the tags
+// of the next one start
+static bool readGames(const char *path, GameQueue &queue) {
+  std::ifstream file(path);
+  if (!file)
+    return false;
+
+  std::string game;
+  std::string line;
+  bool sawMoves = false;
+  while (std::getline(file, line)) {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+
+    bool tag = !line.empty() && line[0] == '[';
+    if (tag && sawMoves) {
+      queue.push(std::move(game));
+      game.clear();
+      sawMoves = false;
+    }
+    if (!tag && line.find_first_not_of(" \t") != std::string::npos)
+      sawMoves = true;
+
+    game += line;
+    game += '\n';
+  }
+  if (sawMoves)
+    queue.push(std::move(game));
+  return true;
+}
+
+// reads records back in order, from a run file or from memory
+class RunSource {
+public:
+  explicit RunSource(std::vector<Record> records)
+      : _records(std::move(records)) {}
+  explicit RunSource(FILE *file) : _file(file) {}
+  ~RunSource() {
+    if (_file != nullptr)
+      fclose(_file);
+  }
+
+  bool next(Record &record) {
+    if (_next == _records.size()) {
+      if (_file == nullptr)
+        return false;
+      _records.resize(RUN_BUFFER_RECORDS);
+      _records.resize(
+          fread(_records.data(), sizeof(Record), RUN_BUFFER_RECORDS, _file));
+      _next = 0;
+      if (_records.empty())
+        return false;
+    }
+    record = _records[_next++];
+    return true;
+  }
+
+private:
+  std::vector<Record> _records;
+  size_t _next = 0;
+  FILE *_file = nullptr;
+};
+
+// writes one position's moves that pass the filters, best first
+static size_t writePosition(FILE *out, const std::vector<Record> &moves,
+                            int minGames) {
+  std::vector<std::pair<uint64_t, uint16_t>> scored;
+  uint64_t maxScore = 0;
+  for (const Record &record : moves) {
+    const Counts &counts = record.counts;
+    uint64_t games = (uint64_t)counts.wins + counts.draws + counts.losses;
+    uint64_t score = 2 * (uint64_t)counts.wins + counts.draws;
+    if (games < (uint64_t)minGames || score == 0)
+      continue;
+    scored.emplace_back(score, record.move);
+    maxScore = std::max(maxScore, score);
+  }
+
+  std::sort(scored.begin(), scored.end(),
+            [](const auto &a, const auto &b) { return a.first > b.first; });
+
+  size_t written = 0;
+  for (const auto &[score, move] : scored) {
+    uint64_t weight = maxScore > 0xFFFF ? score * 0xFFFF / maxScore : score;
+    if (weight == 0)
+      continue;
+
+    PolyglotEntry entry;
+    entry.key = moves[0].key;
+    entry.move = move;
+    entry.weight = (uint16_t)weight;
+    uint8_t data[POLYGLOT_ENTRY_SIZE];
+    writePolyglotEntry(entry, data);
+    fwrite(data, 1, sizeof(data), out);
+    written++;
+  }
+  return written;
+}
+
+// merges sources in key and move order and hands every position and move
+// to emit once, with the counts of all the sources added up
+template <typename Emit>
+static void mergeSources(std::vector<std::unique_ptr<RunSource>> &sources,
+                         Emit emit) {
+  auto greater = [](const std::pair<Record, size_t> &a,
+                    const std::pair<Record, size_t> &b) {
+    return recordLess(b.first, a.first);
+  };
+  std::priority_queue<std::pair<Record, size_t>,
+                      std::vector<std::pair<Record, size_t>>,
+                      decltype(greater)>
+      heads(greater);
+  for (size_t i = 0; i < sources.size(); i++) {
+    Record record;
+    if (sources[i]->next(record))
+      heads.push({record, i});
+  }
+
+  Record pending;
+  bool hasPending = false;
+  while (!heads.empty()) {
+    auto [record, source] = heads.top();
+    heads.pop();
+    Record following;
+    if (sources[source]->next(following))
+      heads.push({following, source});
+
+    if (hasPending && pending.key == record.key &&
+        pending.move == record.move) {
+      pending.counts.wins += record.counts.wins;
+      pending.counts.draws += record.counts.draws;
+      pending.counts.losses += record.counts.losses;
+      continue;
+    }
+    if (hasPending)
+      emit(pending);
+    pending = record;
+    hasPending = true;
+  }
+  if (hasPending)
+    emit(pending);
+}
+
+// opens the run files as merge sources
+static bool openRuns(const std::string *runs, size_t count,
+                     std::vector<std::unique_ptr<RunSource>> &sources) {
+  for (size_t i = 0; i < count; i++) {
+    FILE *file = fopen(runs[i].c_str(), "rb");
+    if (file == nullptr) {
+      fprintf(stderr, "couldn't open run %s\n", runs[i].c_str());
+      return false;
+    }
+    sources.push_back(std::make_unique<RunSource>(file));
+  }
+  return true;
+}
+
+// merges the oldest MERGE_FAN_IN runs into a new one at the end of runs,
+// and deletes them
+static bool mergeRuns(Builder &builder, std::vector<std::string> &runs) {
+  std::vector<std::unique_ptr<RunSource>> sources;
+  if (!openRuns(runs.data(), MERGE_FAN_IN, sources))
+    return false;
+
+  std::string path = runPath(builder);
+  FILE *out = fopen(path.c_str(), "wb");
+  if (out == nullptr) {
+    fprintf(stderr, "couldn't write a run to %s\n", builder.tempDir.c_str());
+    return false;
+  }
+  runs.push_back(path);
+
+  bool written = true;
+  mergeSources(sources, [&](const Record &record) {
+    written = fwrite(&record, sizeof(Record), 1, out) == 1 && written;
+  });
+  written = fclose(out) == 0 && written;
+  if (!written) {
+    fprintf(stderr, "couldn't write a run to %s\n", builder.tempDir.c_str());
+    return false;
+  }
+
+  sources.clear();
+  for (size_t i = 0; i < MERGE_FAN_IN; i++)
+    std::remove(runs[i].c_str());
+  runs.erase(runs.begin(), runs.begin() + MERGE_FAN_IN);
+  return true;
+}
+
+// merges every run and what's left in the workers' maps into the book.
+// runs are the spilled run files, the ones that are left afterwards (merged
+// or not) are up to the caller to delete
+static bool writeBook(Builder &builder, std::vector<Worker> &workers,
+                      std::vector<std::string> &runs, const char *path,
+                      size_t &entries) {
+  while (runs.size() > MERGE_FAN_IN)
+    if (!mergeRuns(builder, runs))
+      return false;
+
+  std::vector<std::unique_ptr<RunSource>> sources;
+  if (!openRuns(runs.data(), runs.size(), sources))
+    return false;
+  for (Worker &worker : workers)
+    sources.push_back(
+        std::make_unique<RunSource>(takeRecords(worker.counts)));
+
+  FILE *out = fopen(path, "wb");
+  if (out == nullptr) {
+    fprintf(stderr, "couldn't write %s\n", path);
+    return false;
+  }
+
+  std::vector<Record> position;
+  entries = 0;
+  mergeSources(sources, [&](const Record &record) {
+    if (!position.empty() && position.back().key != record.key) {
+      entries += writePosition(out, position, builder.minGames);
+      position.clear();
+    }
+    position.push_back(record);
+  });
+  if (!position.empty())
+    entries += writePosition(out, position, builder.minGames);
+
+  if (fclose(out) != 0) {
+    fprintf(stderr, "couldn't write %s\n", path);
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  Builder builder;
+  std::vector<const char *> pgnFiles;
+  const char *outPath = "book.bin";
+  int threads = std::max(1, (int)std::thread::hardware_concurrency());
+  builder.tempDir = std::filesystem::temp_directory_path().string();
+
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--out") == 0 && hasValue) {
+      outPath = argv[++i];
+    } else if (strcmp(argv[i], "--max-ply") == 0 && hasValue) {
+      builder.maxPly = std::max(1, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--min-games") == 0 && hasValue) {
+      builder.minGames = std::max(1, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+      threads = std::max(1, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--memory") == 0 && hasValue) {
+      builder.memoryMB = std::max(1, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--temp") == 0 && hasValue) {
+      builder.tempDir = argv[++i];
+    } else if (argv[i][0] != '-') {
+      pgnFiles.push_back(argv[i]);
+    } else {
+      pgnFiles.clear();
+      break;
+    }
+  }
+
+  if (pgnFiles.empty()) {
+    fprintf(stderr,
+            "usage: %s <games.pgn>... [--out file] [--max-ply n] "
+            "[--min-games n] [--threads n] [--memory mb] [--temp dir]\n",
+            argv[0]);
+    return 1;
+  }
+
+  builder.mapLimit =
+      std::max<size_t>(1, builder.memoryMB * (1 << 20) / threads /
+                              MAP_ENTRY_BYTES);
+  std::random_device random;
+  builder.runPrefix = "bookbuilder-" + std::to_string(random()) + "-";
+
+  std::vector<Worker> workers(threads);
+  std::vector<std::thread> pool;
+  for (int i = 0; i < threads; i++)
+    pool.emplace_back(work, std::ref(builder), std::ref(workers[i]));
+
+  bool readAll = true;
+  for (const char *path : pgnFiles) {
+    if (!readGames(path, builder.queue)) {
+      fprintf(stderr, "couldn't read %s\n", path);
+      readAll = false;
+    }
+  }
+  builder.queue.close();
+  for (std::thread &thread : pool)
+    thread.join();
+
+  uint64_t games = 0;
+  uint64_t skipped = 0;
+  for (const Worker &worker : workers) {
+    games += worker.games;
+    skipped += worker.skipped;
+  }
+
+  int spilled = builder.runCount;
+  std::vector<std::string> runs;
+  for (const Worker &worker : workers)
+    runs.insert(runs.end(), worker.runs.begin(), worker.runs.end());
+
+  size_t entries = 0;
+  bool written = writeBook(builder, workers, runs, outPath, entries);
+  for (const std::string &run : runs)
+    std::remove(run.c_str());
+
+  if (!written)
+    return 1;
+  printf("%llu games (%llu skipped), %d runs spilled, %zu entries in %s\n",
+         (unsigned long long)games, (unsigned long long)skipped, spilled,
+         entries, outPath);
+  return readAll ? 0 : 1;
+}
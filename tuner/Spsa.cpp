@@ -0,0 +1,258 @@
+// spsa tuning of the search parameters (SearchParams in classes/Search.h) by
+// self-play.
+//
+// every iteration picks a random direction, plays a pair of games between the
+// parameters nudged one way and nudged the other way (same opening, each side
+// plays white once) and moves the parameters toward whichever did better.
+// that estimates which way is stronger from two games no matter how many
+// parameters there are, so it takes a lot of games but each one can be short.
+// games are limited by nodes instead of time so the results don't depend on
+// how busy the machine is, and every core plays its own pairs.
+//
+// usage: spsa [--iterations n] [--nodes n] [--threads n] [--openings file]
+//             [--set name=value]...
+//
+// the openings file has one fen per line. without one every pair starts from
+// a few random moves out of the starting position
+
+#include "../classes/Search.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+const int PARAM_COUNT = sizeof(SEARCH_PARAMS) / sizeof(SEARCH_PARAMS[0]);
+
+// games that get this long are called a draw
+const int MAX_GAME_PLIES = 300;
+const int RANDOM_OPENING_PLIES = 8;
+const size_t GAME_TT_MB = 4;
+
+// the usual spsa gain schedules: perturbations shrink with k^GAMMA and steps
+// with (STABILITY + k)^ALPHA, where STABILITY is a tenth of the run
+const double ALPHA = 0.602;
+const double GAMMA = 0.101;
+
+const char *START_FEN =
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// what the tuning is moving, shared by every thread
+struct Tuning {
+  std::mutex mutex;
+  double values[PARAM_COUNT];
+  int iterations = 0;
+  std::atomic<int> started = 0;
+  int finished = 0;
+  double score = 0;
+};
+
+static SearchParams toParams(const double *values) {
+  SearchParams params;
+  for (int i = 0; i < PARAM_COUNT; i++) {
+    const SearchParamInfo &info = SEARCH_PARAMS[i];
+    params.*info.value =
+        std::clamp((int)std::lround(values[i]), info.min, info.max);
+  }
+  // a reduction that reaches the minimum depth would leave nothing to search
+  params.iirReduction = std::min(params.iirReduction, params.iirMinDepth - 1);
+  return params;
+}
+
+static Board randomOpening(std::mt19937_64 &rng,
+                           const std::vector<std::string> &openings) {
+  Board board;
+  if (!openings.empty()) {
+    board.loadFEN(openings[rng() % openings.size()]);
+    return board;
+  }
+
+  // starts over if the random moves run into a finished game
+  while (true) {
+    board.loadFEN(START_FEN);
+    int ply = 0;
+    for (; ply < RANDOM_OPENING_PLIES; ply++) {
+      std::vector<Move> moves = board.GenerateLegalMoves();
+      if (moves.empty())
+        break;
+      board.makeMove(moves[rng() % moves.size()]);
+    }
+    if (ply == RANDOM_OPENING_PLIES && !board.GenerateLegalMoves().empty())
+      return board;
+  }
+}
+
+// 1 if white wins, 0 if black does, 0.5 for a draw
+static double playGame(Board board, const SearchParams &white,
+                       const SearchParams &black, uint64_t nodes) {
+  std::unique_ptr<TranspositionTable> tables[2] = {
+      std::make_unique<TranspositionTable>(GAME_TT_MB),
+      std::make_unique<TranspositionTable>(GAME_TT_MB)};
+  std::unique_ptr<SearchContext> contexts[2] = {
+      std::make_unique<SearchContext>(), std::make_unique<SearchContext>()};
+  for (int side = 0; side < 2; side++) {
+    contexts[side]->tt = tables[side].get();
+    contexts[side]->params = side == 0 ? white : black;
+  }
+
+  std::vector<uint64_t> history;
+  for (int ply = 0; ply < MAX_GAME_PLIES; ply++) {
+    std::vector<Move> moves = board.GenerateLegalMoves();
+    if (moves.empty()) {
+      if (!board.isInCheck())
+        return 0.5;
+      return board.isWhiteTurn ? 0 : 1;
+    }
+    if (board.halfmoveClock >= 100 || board.hasInsufficientMaterial() ||
+        board.repetitionCount(history) >= 2)
+      return 0.5;
+
+    SearchContext &context = *contexts[board.isWhiteTurn ? 0 : 1];
+    context.stats = SearchStats{};
+    SearchLine line = searchNodes(board, context, nodes, history);
+
+    history.push_back(board.hash);
+    board.makeMove(line.move);
+  }
+
+  return 0.5;
+}
+
+static void runWorker(Tuning &tuning, uint64_t nodes,
+                      const std::vector<std::string> &openings,
+                      uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  double stability = tuning.iterations / 10.0;
+
+  while (true) {
+    int k = ++tuning.started;
+    if (k > tuning.iterations)
+      return;
+
+    double values[PARAM_COUNT];
+    double c[PARAM_COUNT];
+    int direction[PARAM_COUNT];
+    {
+      std::lock_guard<std::mutex> lock(tuning.mutex);
+      std::copy(tuning.values, tuning.values + PARAM_COUNT, values);
+    }
+
+    double plus[PARAM_COUNT], minus[PARAM_COUNT];
+    for (int i = 0; i < PARAM_COUNT; i++) {
+      c[i] = SEARCH_PARAMS[i].step / std::pow(k, GAMMA);
+      direction[i] = rng() & 1 ? 1 : -1;
+      plus[i] = values[i] + c[i] * direction[i];
+      minus[i] = values[i] - c[i] * direction[i];
+    }
+
+    Board opening = randomOpening(rng, openings);
+    SearchParams plusParams = toParams(plus);
+    SearchParams minusParams = toParams(minus);
+    double plusScore = playGame(opening, plusParams, minusParams, nodes) +
+                       (1 - playGame(opening, minusParams, plusParams, nodes));
+    // -2 to 2, how much better the plus side did
+    double result = plusScore - (2 - plusScore);
+
+    std::lock_guard<std::mutex> lock(tuning.mutex);
+    for (int i = 0; i < PARAM_COUNT; i++) {
+      const SearchParamInfo &info = SEARCH_PARAMS[i];
+      // scaled so at the start a game point of difference moves a parameter
+      // by about its step
+      double a = 2 * info.step * info.step * std::pow(stability + 1, ALPHA) /
+                 std::pow(stability + k, ALPHA);
+      tuning.values[i] += a * result / (2 * c[i] * direction[i]);
+      tuning.values[i] =
+          std::clamp(tuning.values[i], (double)info.min, (double)info.max);
+    }
+
+    tuning.finished++;
+    tuning.score += plusScore;
+    if (tuning.finished % 10 == 0 || tuning.finished == tuning.iterations) {
+      printf("%d/%d pairs", tuning.finished, tuning.iterations);
+      for (int i = 0; i < PARAM_COUNT; i++)
+        printf("  %s %.2f", SEARCH_PARAMS[i].name, tuning.values[i]);
+      printf("\n");
+      fflush(stdout);
+    }
+  }
+}
+
+static bool setParam(Tuning &tuning, const char *assignment) {
+  const char *equals = strchr(assignment, '=');
+  if (equals == nullptr)
+    return false;
+
+  std::string name(assignment, equals);
+  for (int i = 0; i < PARAM_COUNT; i++) {
+    if (name == SEARCH_PARAMS[i].name) {
+      tuning.values[i] = atof(equals + 1);
+      return true;
+    }
+  }
+  return false;
+}
+
+int main(int argc, char **argv) {
+  Tuning tuning;
+  tuning.iterations = 2000;
+  uint64_t nodes = 2000;
+  int threads = std::max(1, (int)std::thread::hardware_concurrency());
+  std::vector<std::string> openings;
+
+  SearchParams defaults;
+  for (int i = 0; i < PARAM_COUNT; i++)
+    tuning.values[i] = defaults.*SEARCH_PARAMS[i].value;
+
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--iterations") == 0 && hasValue) {
+      tuning.iterations = std::max(1, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--nodes") == 0 && hasValue) {
+      nodes = std::max(1, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+      threads = std::max(1, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--openings") == 0 && hasValue) {
+      std::ifstream file(argv[++i]);
+      for (std::string line; std::getline(file, line);)
+        if (Board().loadFEN(line))
+          openings.push_back(line);
+    } else if (strcmp(argv[i], "--set") == 0 && hasValue) {
+      if (!setParam(tuning, argv[++i])) {
+        fprintf(stderr, "unknown parameter %s\n", argv[i]);
+        return 1;
+      }
+    } else {
+      fprintf(stderr,
+              "usage: %s [--iterations n] [--nodes n] [--threads n] "
+              "[--openings file] [--set name=value]...\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  printf("%d game pairs at %llu nodes a move on %d threads\n",
+         tuning.iterations, (unsigned long long)nodes, threads);
+
+  std::vector<std::thread> workers;
+  std::random_device seeds;
+  for (int i = 0; i < threads; i++)
+    workers.emplace_back(runWorker, std::ref(tuning), nodes,
+                         std::cref(openings), ((uint64_t)seeds() << 32) | i);
+  for (auto &worker : workers)
+    worker.join();
+
+  printf("plus side scored %.1f%%\n",
+         100 * tuning.score / (2.0 * tuning.finished));
+  SearchParams tuned = toParams(tuning.values);
+  for (int i = 0; i < PARAM_COUNT; i++)
+    printf("%s=%d\n", SEARCH_PARAMS[i].name, tuned.*SEARCH_PARAMS[i].value);
+  return 0;
+}
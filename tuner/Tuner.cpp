@@ -0,0 +1,483 @@
+// texel tuner for the evaluation parameters in classes/EvalParameters.h.
+//
+// every position in the data set comes with the result of the game it was
+// taken from. the evaluation, squashed into a win probability by a sigmoid,
+// should predict that result, so the parameters are fitted to minimize the
+// mean squared difference over the whole set.
+//
+// the tuned part of the evaluation is linear in the parameters: every piece
+// adds its value and its table entry, and every pawn structure, shelter,
+// mobility, threat and space term is a count times a value, mg weighted by
+// the game phase and eg by the rest (times the endgame scale factor). the
+// traced evaluation tells us which pieces are where, how often each of the
+// other parameters counted, the phase, the scale factor and what the terms
+// that aren't linear (imbalance, king safety) add up to, so each position is
+// boiled down to a short list of coefficients once and the fitting never has
+// to touch a board again.
+//
+// usage: tuner <positions> [--out file] [--epochs n] [--threads n] [--rate r]
+//
+// a line of the positions file is a fen followed by the result for white,
+// either as [1.0] / [0.5] / [0.0] or as 1-0 / 1/2-1/2 / 0-1 (so the usual
+// "fen c9 "1-0";" epd sets work too). lines that don't parse are skipped
+
+#include "../classes/EvalTrace.h"
+#include "../classes/Material.h"
+#include "../classes/PieceSquareTables.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// pawn to king values, then a table per piece type, then every EvalParam.
+// once for mg, once for eg
+const int PIECE_PARAMS = 6 + 6 * 64;
+const int HALF_PARAMS = PIECE_PARAMS + EVAL_PARAMS;
+const int PARAMS = 2 * HALF_PARAMS;
+
+// terms that aren't a sum of counts times values, left as they are
+const EvalTerm FIXED_TERMS[] = {TermImbalance, TermKingSafety};
+
+// the counted parameters the way EvalParameters.h lays them out. a group
+// without eg values is middlegame only, its name has no MG_ prefix then
+struct ParamGroup {
+  const char *name;
+  // written above the group, with a blank line before it
+  const char *comment;
+  int first;
+  // 1 for a single value instead of an array
+  int count;
+  const int *mg;
+  const int *eg;
+};
+
+const ParamGroup PARAM_GROUPS[] = {
+    {"PASSED_PAWN",
+     "passed pawns by how far they've advanced (rank 1 for a side's first "
+     "rank)",
+     ParamPassedPawn, 8, MG_PASSED_PAWN, EG_PASSED_PAWN},
+    {"DOUBLED_PAWN", nullptr, ParamDoubledPawn, 1, &MG_DOUBLED_PAWN,
+     &EG_DOUBLED_PAWN},
+    {"ISOLATED_PAWN", nullptr, ParamIsolatedPawn, 1, &MG_ISOLATED_PAWN,
+     &EG_ISOLATED_PAWN},
+    {"BACKWARD_PAWN", nullptr, ParamBackwardPawn, 1, &MG_BACKWARD_PAWN,
+     &EG_BACKWARD_PAWN},
+    {"SHIELD_PENALTY",
+     "middlegame only. by distance from the king to the closest friendly pawn "
+     "on\n// a file in front of it, nothing within 3 ranks counts as no shield "
+     "at all",
+     ParamShield, 4, SHIELD_PENALTY, nullptr},
+    {"NO_SHIELD_PENALTY", nullptr, ParamNoShield, 1, &NO_SHIELD_PENALTY,
+     nullptr},
+    {"MOBILITY",
+     "per safe square above or below what the piece usually has, by piece "
+     "type",
+     ParamMobility, 7, MG_MOBILITY, EG_MOBILITY},
+    {"PAWN_THREAT",
+     "per enemy piece our pawns attack, per undefended enemy piece we attack "
+     "and\n// per safe square behind our pawns in the centre",
+     ParamPawnThreat, 1, &MG_PAWN_THREAT, &EG_PAWN_THREAT},
+    {"HANGING_PIECE", nullptr, ParamHangingPiece, 1, &MG_HANGING_PIECE,
+     &EG_HANGING_PIECE},
+    {"SPACE", nullptr, ParamSpace, 1, &MG_SPACE, &EG_SPACE},
+};
+
+struct Coefficient {
+  uint16_t index;
+  int16_t value;
+};
+
+// one position, reduced to what the fit needs
+struct Position {
+  float result;
+  // how much of the mg and eg parameter values end up in the score
+  float mgWeight;
+  float egWeight;
+  // everything that isn't being tuned, already tapered, from white's side
+  float fixed;
+  uint32_t first;
+  uint32_t count;
+};
+
+// the positions one thread loads and later computes gradients for
+struct Shard {
+  std::vector<Position> positions;
+  std::vector<Coefficient> coefficients;
+};
+
+static int valueIndex(int type) { return type - 1; }
+
+static int tableIndex(int type, int tableSquare) {
+  return 6 + (type - 1) * 64 + tableSquare;
+}
+
+static int countedIndex(int param) { return PIECE_PARAMS + param; }
+
+// result for white, or a negative number if there isn't one
+static float parseResult(const std::string &line) {
+  size_t fenEnd = line.find(' ');
+  if (fenEnd == std::string::npos)
+    return -1;
+
+  size_t bracket = line.find('[', fenEnd);
+  if (bracket != std::string::npos)
+    return strtof(line.c_str() + bracket + 1, nullptr);
+  if (line.find("1/2-1/2", fenEnd) != std::string::npos)
+    return 0.5f;
+  if (line.find("1-0", fenEnd) != std::string::npos)
+    return 1;
+  if (line.find("0-1", fenEnd) != std::string::npos)
+    return 0;
+  return -1;
+}
+
+static bool addPosition(const std::string &line, Shard &shard) {
+  float result = parseResult(line);
+  Board board;
+  if (result < 0 || result > 1 || !board.loadFEN(line))
+    return false;
+
+  EvalTrace trace;
+  board.evaluate(&board, trace);
+  // known endgames have their own scoring, none of the parameters matter
+  if (trace.endgame)
+    return false;
+
+  Position position;
+  position.result = result;
+  position.mgWeight = (float)trace.phase / MAX_PHASE;
+  position.egWeight = (float)(MAX_PHASE - trace.phase) / MAX_PHASE *
+                      trace.scaleFactor / SCALE_NORMAL;
+
+  int fixed = 0;
+  for (EvalTerm term : FIXED_TERMS)
+    fixed += trace.terms[term][0] - trace.terms[term][1];
+  position.fixed =
+      mgValue(fixed) * position.mgWeight + egValue(fixed) * position.egWeight;
+
+  // white and black cancel out a lot (pawn values especially), so add the
+  // coefficients up before keeping the ones that are left
+  int coefficients[HALF_PARAMS] = {};
+  for (const TracedPiece &piece : trace.pieces) {
+    int sign = piece.side == 0 ? 1 : -1;
+    coefficients[valueIndex(piece.type)] += sign;
+    coefficients[tableIndex(piece.type, piece.tableSquare)] += sign;
+  }
+  for (int param = 0; param < EVAL_PARAMS; param++)
+    coefficients[countedIndex(param)] +=
+        trace.counts[param][0] - trace.counts[param][1];
+
+  position.first = (uint32_t)shard.coefficients.size();
+  for (int i = 0; i < HALF_PARAMS; i++)
+    if (coefficients[i] != 0)
+      shard.coefficients.push_back({(uint16_t)i, (int16_t)coefficients[i]});
+  position.count = (uint32_t)shard.coefficients.size() - position.first;
+
+  shard.positions.push_back(position);
+  return true;
+}
+
+static double evaluate(const Shard &shard, const Position &position,
+                       const std::vector<double> &params) {
+  double score = position.fixed;
+  for (uint32_t i = 0; i < position.count; i++) {
+    const Coefficient &c = shard.coefficients[position.first + i];
+    score += c.value * (params[c.index] * position.mgWeight +
+                        params[HALF_PARAMS + c.index] * position.egWeight);
+  }
+  return score;
+}
+
+static double sigmoid(double k, double score) {
+  return 1 / (1 + std::pow(10.0, -k * score / 400));
+}
+
+// runs work(shard, thread) on every shard at once
+static void forEachShard(std::vector<Shard> &shards,
+                         const std::function<void(Shard &, int)> &work) {
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < shards.size(); i++)
+    threads.emplace_back([&, i] { work(shards[i], (int)i); });
+  for (auto &thread : threads)
+    thread.join();
+}
+
+static double meanError(std::vector<Shard> &shards, size_t total,
+                        const std::vector<double> &params, double k) {
+  std::vector<double> errors(shards.size(), 0);
+  forEachShard(shards, [&](Shard &shard, int thread) {
+    double sum = 0;
+    for (const Position &position : shard.positions) {
+      double error =
+          position.result - sigmoid(k, evaluate(shard, position, params));
+      sum += error * error;
+    }
+    errors[thread] = sum;
+  });
+
+  double sum = 0;
+  for (double error : errors)
+    sum += error;
+  return sum / total;
+}
+
+// gradient of the mean error with respect to every parameter
+static void gradient(std::vector<Shard> &shards, size_t total,
+                     const std::vector<double> &params, double k,
+                     std::vector<double> &out) {
+  std::vector<std::vector<double>> partial(shards.size());
+  forEachShard(shards, [&](Shard &shard, int thread) {
+    std::vector<double> &sum = partial[thread];
+    sum.assign(PARAMS, 0);
+    for (const Position &position : shard.positions) {
+      double predicted = sigmoid(k, evaluate(shard, position, params));
+      // d(error)/d(score), the constant factors are applied below
+      double slope =
+          (position.result - predicted) * predicted * (1 - predicted);
+      for (uint32_t i = 0; i < position.count; i++) {
+        const Coefficient &c = shard.coefficients[position.first + i];
+        sum[c.index] += slope * c.value * position.mgWeight;
+        sum[HALF_PARAMS + c.index] += slope * c.value * position.egWeight;
+      }
+    }
+  });
+
+  double scale = -2.0 * k * std::log(10.0) / 400 / total;
+  out.assign(PARAMS, 0);
+  for (const auto &sum : partial)
+    for (int i = 0; i < PARAMS; i++)
+      out[i] += sum[i] * scale;
+
+  // middlegame only parameters keep their eg value at 0
+  for (const ParamGroup &group : PARAM_GROUPS)
+    if (group.eg == nullptr)
+      for (int i = 0; i < group.count; i++)
+        out[HALF_PARAMS + countedIndex(group.first + i)] = 0;
+}
+
+// the sigmoid scale that makes the current evaluation fit best, so the fit
+// moves the parameters rather than just stretching every score
+static double fitScale(std::vector<Shard> &shards, size_t total,
+                       const std::vector<double> &params) {
+  double low = 0, high = 4;
+  for (int i = 0; i < 40; i++) {
+    double a = low + (high - low) / 3;
+    double b = high - (high - low) / 3;
+    if (meanError(shards, total, params, a) <
+        meanError(shards, total, params, b))
+      high = b;
+    else
+      low = a;
+  }
+  return (low + high) / 2;
+}
+
+static std::vector<double> initialParams() {
+  std::vector<double> params(PARAMS);
+  for (int type = Pawn; type <= King; type++) {
+    params[valueIndex(type)] = MG_PIECE_VALUES[type];
+    params[HALF_PARAMS + valueIndex(type)] = EG_PIECE_VALUES[type];
+    for (int square = 0; square < 64; square++) {
+      params[tableIndex(type, square)] = MG_TABLES[type][square];
+      params[HALF_PARAMS + tableIndex(type, square)] =
+          EG_TABLES[type][square];
+    }
+  }
+
+  for (const ParamGroup &group : PARAM_GROUPS) {
+    for (int i = 0; i < group.count; i++) {
+      int index = countedIndex(group.first + i);
+      params[index] = group.mg[i];
+      params[HALF_PARAMS + index] = group.eg != nullptr ? group.eg[i] : 0;
+    }
+  }
+  return params;
+}
+
+static void writeValues(FILE *out, const char *name,
+                        const std::vector<double> &params, int offset) {
+  fprintf(out, "inline constexpr int %s[] = {0", name);
+  for (int type = Pawn; type <= King; type++)
+    fprintf(out, ", %d",
+            type == King ? 0 : (int)std::lround(params[offset + type - 1]));
+  fprintf(out, "};\n");
+}
+
+static void writeGroup(FILE *out, const std::string &name,
+                       const std::vector<double> &params, int offset,
+                       const ParamGroup &group) {
+  int first = offset + countedIndex(group.first);
+  if (group.count == 1) {
+    fprintf(out, "inline constexpr int %s = %ld;\n", name.c_str(),
+            std::lround(params[first]));
+    return;
+  }
+
+  fprintf(out, "inline constexpr int %s[%d] = {", name.c_str(), group.count);
+  for (int i = 0; i < group.count; i++)
+    fprintf(out, "%s%ld", i == 0 ? "" : ", ", std::lround(params[first + i]));
+  fprintf(out, "};\n");
+}
+
+static void writeTable(FILE *out, const char *name,
+                       const std::vector<double> &params, int offset,
+                       int type) {
+  fprintf(out, "inline constexpr int %s[64] = {\n", name);
+  for (int rank = 0; rank < 8; rank++) {
+    fprintf(out, "   ");
+    for (int file = 0; file < 8; file++)
+      fprintf(out, "%4ld,",
+              std::lround(params[offset + tableIndex(type, rank * 8 + file)]));
+    fprintf(out, "\n");
+  }
+  fprintf(out, "};\n");
+}
+
+// same layout as the hand written file, so a tuning run is a readable diff
+static bool writeHeader(const char *path, const std::vector<double> &params) {
+  FILE *out = fopen(path, "w");
+  if (out == nullptr)
+    return false;
+
+  fprintf(out,
+          "#pragma once\n\n"
+          "// written by the tuner (tuner/Tuner.cpp), which fits these to game "
+          "results.\n"
+          "// editing them by hand is fine, the next tuning run just starts "
+          "from there\n\n");
+  writeValues(out, "MG_PIECE_VALUES", params, 0);
+  writeValues(out, "EG_PIECE_VALUES", params, HALF_PARAMS);
+
+  for (const ParamGroup &group : PARAM_GROUPS) {
+    if (group.comment != nullptr)
+      fprintf(out, "\n// %s\n", group.comment);
+    if (group.eg == nullptr) {
+      writeGroup(out, group.name, params, 0, group);
+      continue;
+    }
+    writeGroup(out, std::string("MG_") + group.name, params, 0, group);
+    writeGroup(out, std::string("EG_") + group.name, params, HALF_PARAMS,
+               group);
+  }
+  fprintf(out,
+          "\n// piece square tables from white's side the way the board is "
+          "drawn, so a8 is\n"
+          "// the first entry and h1 the last. black reads them flipped\n\n"
+          "// clang-format off\n");
+
+  const char *names[] = {"PAWN", "KNIGHT", "BISHOP", "ROOK", "QUEEN", "KING"};
+  for (int type = Pawn; type <= King; type++) {
+    std::string mg = std::string("MG_") + names[type - 1] + "_TABLE";
+    std::string eg = std::string("EG_") + names[type - 1] + "_TABLE";
+    writeTable(out, mg.c_str(), params, 0, type);
+    fprintf(out, "\n");
+    writeTable(out, eg.c_str(), params, HALF_PARAMS, type);
+    if (type != King)
+      fprintf(out, "\n");
+  }
+  fprintf(out, "// clang-format on\n");
+
+  return fclose(out) == 0;
+}
+
+static std::vector<Shard> loadPositions(const char *path, int threads,
+                                        size_t &total) {
+  std::vector<std::string> lines;
+  std::ifstream file(path);
+  for (std::string line; std::getline(file, line);)
+    lines.push_back(line);
+
+  std::vector<Shard> shards(threads);
+  forEachShard(shards, [&](Shard &shard, int thread) {
+    size_t begin = lines.size() * thread / threads;
+    size_t end = lines.size() * (thread + 1) / threads;
+    for (size_t i = begin; i < end; i++)
+      addPosition(lines[i], shard);
+  });
+
+  total = 0;
+  for (const Shard &shard : shards)
+    total += shard.positions.size();
+  return shards;
+}
+
+int main(int argc, char **argv) {
+  const char *positionsPath = nullptr;
+  const char *outPath = "EvalParameters.h";
+  int epochs = 1000;
+  int threads = std::max(1, (int)std::thread::hardware_concurrency());
+  double rate = 1.0;
+
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--out") == 0 && hasValue)
+      outPath = argv[++i];
+    else if (strcmp(argv[i], "--epochs") == 0 && hasValue)
+      epochs = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+      threads = std::max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--rate") == 0 && hasValue)
+      rate = atof(argv[++i]);
+    else
+      positionsPath = argv[i];
+  }
+
+  if (positionsPath == nullptr) {
+    fprintf(stderr, "usage: %s <positions> [--out file] [--epochs n] "
+                    "[--threads n] [--rate r]\n",
+            argv[0]);
+    return 1;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  auto seconds = [&] {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+  };
+
+  size_t total = 0;
+  std::vector<Shard> shards = loadPositions(positionsPath, threads, total);
+  if (total == 0) {
+    fprintf(stderr, "no usable positions in %s\n", positionsPath);
+    return 1;
+  }
+  printf("%zu positions loaded in %.1fs\n", total, seconds());
+
+  std::vector<double> params = initialParams();
+  double k = fitScale(shards, total, params);
+  printf("k %.4f, error %.6f\n", k, meanError(shards, total, params, k));
+
+  // adam, full batch
+  const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+  std::vector<double> m(PARAMS, 0), v(PARAMS, 0), grad;
+  for (int epoch = 1; epoch <= epochs; epoch++) {
+    gradient(shards, total, params, k, grad);
+    double correction1 = 1 - std::pow(beta1, epoch);
+    double correction2 = 1 - std::pow(beta2, epoch);
+    for (int i = 0; i < PARAMS; i++) {
+      m[i] = beta1 * m[i] + (1 - beta1) * grad[i];
+      v[i] = beta2 * v[i] + (1 - beta2) * grad[i] * grad[i];
+      params[i] -= rate * (m[i] / correction1) /
+                   (std::sqrt(v[i] / correction2) + epsilon);
+    }
+
+    if (epoch % 50 == 0 || epoch == epochs)
+      printf("epoch %d, error %.6f, %.1fs\n", epoch,
+             meanError(shards, total, params, k), seconds());
+  }
+
+  if (!writeHeader(outPath, params)) {
+    fprintf(stderr, "couldn't write %s\n", outPath);
+    return 1;
+  }
+  printf("wrote %s\n", outPath);
+  return 0;
+}